@@ -0,0 +1,111 @@
+#ifndef CORPUS_HPP
+#define CORPUS_HPP
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/TorrentParser.hpp"
+
+// Deterministic generators of realistic Bencode documents for benchmarks
+class Corpus {
+ public:
+  explicit Corpus(uint64_t seed = 42) : rng(seed) {}
+
+  // Single-file torrent of `totalSize` bytes split into `pieceLength` pieces
+  std::string singleFileTorrent(int64_t totalSize, int64_t pieceLength) {
+    std::map<BencodeValue::KeyType, BencodeValue> info;
+    info["length"] = BencodeValue(totalSize);
+    info["name"] = BencodeValue(randomName(24) + ".iso");
+    info["piece length"] = BencodeValue(pieceLength);
+    info["pieces"] = BencodeValue(pieces(totalSize, pieceLength));
+    return wrap(info);
+  }
+
+  // Multi-file torrent with `files` files of random size, nested up to three
+  // directories deep
+  std::string multiFileTorrent(size_t files, int64_t pieceLength) {
+    std::vector<BencodeValue> list;
+    list.reserve(files);
+    int64_t total = 0;
+    std::uniform_int_distribution<int64_t> size(1, 512 << 10);
+    std::uniform_int_distribution<int> depth(1, 3);
+    for (size_t i = 0; i < files; i++) {
+      std::vector<BencodeValue> path;
+      for (int d = depth(rng); d > 0; d--) path.push_back(randomName(12));
+      std::map<BencodeValue::KeyType, BencodeValue> file;
+      int64_t length = size(rng);
+      total += length;
+      file["length"] = BencodeValue(length);
+      file["path"] = BencodeValue(path);
+      list.push_back(file);
+    }
+    std::map<BencodeValue::KeyType, BencodeValue> info;
+    info["files"] = BencodeValue(list);
+    info["name"] = BencodeValue(randomName(16));
+    info["piece length"] = BencodeValue(pieceLength);
+    info["pieces"] = BencodeValue(pieces(total, pieceLength));
+    return wrap(info);
+  }
+
+  // KRPC find_node response carrying `nodes` compact node entries
+  std::string dhtResponse(size_t nodes) {
+    std::map<BencodeValue::KeyType, BencodeValue> r;
+    r["id"] = BencodeValue(randomBytes(20));
+    r["nodes"] = BencodeValue(randomBytes(26 * nodes));
+    std::map<BencodeValue::KeyType, BencodeValue> msg;
+    msg["r"] = BencodeValue(r);
+    msg["t"] = BencodeValue(randomBytes(2));
+    msg["y"] = BencodeValue(std::string("r"));
+    return BencodeValue(msg).toString();
+  }
+
+  // Message nested `depth` levels deep through alternating lists and dicts
+  std::string nestedMessage(size_t depth) {
+    BencodeValue value(randomBytes(20));
+    for (size_t i = 0; i < depth; i++) {
+      if (i % 2) {
+        value = BencodeValue(std::vector<BencodeValue>{value, BencodeValue(
+                                                               int64_t(i))});
+      } else {
+        std::map<BencodeValue::KeyType, BencodeValue> dict;
+        dict["a"] = value;
+        dict["id"] = BencodeValue(randomBytes(20));
+        value = BencodeValue(dict);
+      }
+    }
+    return value.toString();
+  }
+
+ private:
+  std::string wrap(const std::map<BencodeValue::KeyType, BencodeValue>& info) {
+    std::map<BencodeValue::KeyType, BencodeValue> torrent;
+    torrent["announce"] = BencodeValue(std::string("udp://tracker.example:1337"));
+    torrent["created by"] = BencodeValue(std::string("SmolTorrent"));
+    torrent["creation date"] = BencodeValue(int64_t{1700000000});
+    torrent["info"] = BencodeValue(info);
+    return BencodeValue(torrent).toString();
+  }
+
+  std::string pieces(int64_t totalSize, int64_t pieceLength) {
+    return randomBytes(20 * ((totalSize + pieceLength - 1) / pieceLength));
+  }
+
+  std::string randomBytes(size_t n) {
+    std::string bytes(n, '\0');
+    for (char& c : bytes) c = static_cast<char>(rng());
+    return bytes;
+  }
+
+  std::string randomName(size_t n) {
+    static constexpr char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string name(n, '\0');
+    for (char& c : name) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    return name;
+  }
+
+  std::mt19937_64 rng;
+};
+
+#endif
@@ -0,0 +1,152 @@
+// Run from the repository root:
+//   g++ -std=c++20 -O2 -pthread bench/bench_Bencode.cpp -o bench_Bencode &&
+//   ./bench_Bencode
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../include/BencodeParallel.hpp"
+#include "../include/BencodeQuery.hpp"
+#include "../include/BencodeStream.hpp"
+#include "../include/BencodeTape.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/TorrentParser.hpp"
+#include "Corpus.hpp"
+
+// Count every heap allocation made by the process
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+  std::free(p);
+}
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+static long peakRssKiB() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Run `fn` over every document until about half a second has passed and
+// report throughput and heap allocations per document
+static void measure(const std::string& name,
+                    const std::vector<std::string>& docs,
+                    const std::function<void(const std::string&)>& fn) {
+  using clock = std::chrono::steady_clock;
+  size_t bytes = 0;
+  for (const auto& doc : docs) bytes += doc.size();
+
+  fn(docs.front());  // Warm up caches and reusable buffers
+  size_t rounds = 0;
+  size_t before = allocations.load();
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    for (const auto& doc : docs) fn(doc);
+    rounds++;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < 0.5);
+  size_t allocs = allocations.load() - before;
+
+  std::cout << "  " << std::left << std::setw(22) << name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(12)
+            << bytes * rounds / elapsed.count() / 1e6 << " MB/s"
+            << std::setw(14) << double(allocs) / (rounds * docs.size())
+            << " allocs/doc" << std::endl;
+}
+
+static void runCorpus(const std::string& title,
+                      const std::vector<std::string>& docs) {
+  size_t bytes = 0;
+  for (const auto& doc : docs) bytes += doc.size();
+  std::cout << title << ": " << docs.size() << " docs, " << bytes
+            << " bytes" << std::endl;
+
+  Bencoder bencoder;
+  measure("Bencoder::decode", docs,
+          [&](const std::string& doc) { bencoder.decode(doc); });
+  measure("Bencoder::decodeView", docs,
+          [&](const std::string& doc) { bencoder.decodeView(doc); });
+
+  static ThreadPool pool;
+  ParallelDecoder parallel(pool);
+  measure("ParallelDecoder x" + std::to_string(pool.size()), docs,
+          [&](const std::string& doc) { parallel.decode(doc); });
+
+  Arena arena;
+  TapeDecoder tape(arena);
+  measure("TapeDecoder", docs, [&](const std::string& doc) {
+    arena.reset();
+    tape.decode(doc);
+  });
+
+  measure("BencodeStreamDecoder", docs, [&](const std::string& doc) {
+    BencodeValueBuilder builder;
+    BencodeStreamDecoder stream(builder);
+    for (size_t pos = 0; pos < doc.size(); pos += 1460) {
+      stream.feed(std::string_view(doc).substr(pos, 1460));
+    }
+  });
+
+  measure("BencodeCursor skip", docs, [&](const std::string& doc) {
+    BencodeCursor(doc).raw();
+  });
+
+  std::vector<BencodeValue> values;
+  for (const auto& doc : docs) values.push_back(bencoder.decode(doc));
+  size_t next = 0;
+  measure("BencodeValue::toString", docs, [&](const std::string&) {
+    values[next++ % values.size()].toString();
+  });
+  std::string out;
+  measure("Bencoder::encode reuse", docs, [&](const std::string&) {
+    bencoder.encode(values[next++ % values.size()], out);
+  });
+
+  std::cout << "  peak RSS so far " << peakRssKiB() / 1024 << " MiB"
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::string path = argc > 1
+                         ? argv[1]
+                         : "torrents/ubuntu-20.04.6-desktop-amd64.iso.torrent";
+  {
+    MappedFile file(path);
+    runCorpus("shipped " + path, {std::string(file.view())});
+  }
+
+  Corpus corpus;
+  runCorpus("single-file 64 GiB, 4 MiB pieces",
+            {corpus.singleFileTorrent(int64_t{64} << 30, 4 << 20)});
+  runCorpus("single-file 4 GiB, 16 KiB pieces",
+            {corpus.singleFileTorrent(int64_t{4} << 30, 16 << 10)});
+  runCorpus("multi-file 100k files, 4 MiB pieces",
+            {corpus.multiFileTorrent(100000, 4 << 20)});
+  runCorpus("multi-file 100k files, 16 KiB pieces",
+            {corpus.multiFileTorrent(100000, 16 << 10)});
+
+  std::vector<std::string> dht;
+  for (int i = 0; i < 1000; i++) dht.push_back(corpus.dhtResponse(8));
+  runCorpus("DHT find_node responses", dht);
+
+  std::vector<std::string> nested;
+  for (int i = 0; i < 100; i++) nested.push_back(corpus.nestedMessage(64));
+  runCorpus("nested DHT messages, depth 64", nested);
+  return 0;
+}
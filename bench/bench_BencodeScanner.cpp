@@ -0,0 +1,68 @@
+// Run from the repository root:
+//   g++ -std=c++20 -O2 bench/bench_BencodeScanner.cpp -o bench_BencodeScanner && ./bench_BencodeScanner
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../include/BencodeTape.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/TorrentParser.hpp"
+
+// Run `fn` repeatedly for about half a second and report MB/s over `bytes`
+template <typename F>
+static void measure(const std::string& name, size_t bytes, F fn) {
+  using clock = std::chrono::steady_clock;
+  size_t iterations = 0;
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    fn();
+    iterations++;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < 0.5);
+  double mbps = bytes * iterations / elapsed.count() / 1e6;
+  std::cout << std::left << std::setw(32) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1) << mbps
+            << " MB/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  std::string path = argc > 1
+                         ? argv[1]
+                         : "torrents/ubuntu-20.04.6-desktop-amd64.iso.torrent";
+  MappedFile file(path);
+  std::string_view data = file.view();
+  std::cout << path << " (" << data.size() << " bytes)" << std::endl;
+
+  // Structural pre-pass on its own, per kernel
+  StructuralIndex index;
+  measure("scan scalar", data.size(),
+          [&] { index.build(data, StructuralIndex::Kernel::Scalar); });
+  measure("scan SSE2", data.size(),
+          [&] { index.build(data, StructuralIndex::Kernel::SSE2); });
+  if (StructuralIndex::bestKernel() == StructuralIndex::Kernel::AVX2) {
+    measure("scan AVX2", data.size(),
+            [&] { index.build(data, StructuralIndex::Kernel::AVX2); });
+  }
+
+  // Full decoders
+  Bencoder bencoder;
+  measure("Bencoder::decode", data.size(), [&] { bencoder.decode(data); });
+  measure("Bencoder::decodeView", data.size(),
+          [&] { bencoder.decodeView(data); });
+
+  Arena arena;
+  TapeDecoder tape(arena);
+  tape.setIndexThreshold(SIZE_MAX);
+  measure("TapeDecoder", data.size(), [&] {
+    arena.reset();
+    tape.decode(data);
+  });
+  tape.setIndexThreshold(0);
+  measure("TapeDecoder + StructuralIndex", data.size(), [&] {
+    arena.reset();
+    tape.decode(data);
+  });
+  return 0;
+}
@@ -0,0 +1,62 @@
+// Run from the repository root:
+//   g++ -std=c++20 -O2 bench/bench_NodeIdTable.cpp -o bench_NodeIdTable && ./bench_NodeIdTable
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/dht/NodeIdTable.hpp"
+
+// Run `fn` repeatedly for about half a second and report lookups/s
+template <typename F>
+static void measure(const std::string& name, F fn) {
+  using clock = std::chrono::steady_clock;
+  size_t iterations = 0;
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    fn();
+    iterations++;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < 0.5);
+  std::cout << std::left << std::setw(32) << name << std::right
+            << std::setw(14) << std::fixed << std::setprecision(0)
+            << iterations / elapsed.count() << " lookups/s" << std::endl;
+}
+
+int main() {
+  constexpr size_t k = 20;
+  std::mt19937 rng(1);
+  for (size_t count : {100, 1000, 10000}) {
+    std::vector<NodeId> ids(count);
+    for (auto& id : ids) {
+      NodeId::Bytes bytes;
+      for (auto& byte : bytes) byte = static_cast<uint8_t>(rng());
+      id = NodeId::fromBytes(bytes);
+    }
+    NodeId target = ids[count / 2] ^ ids[0];
+    std::vector<NodeId> result;
+
+    std::cout << count << " candidates, k = " << k << std::endl;
+    measure("sort with compareDistance", [&] {
+      std::vector<NodeId> sorted = ids;
+      std::sort(sorted.begin(), sorted.end(),
+                [&](const NodeId& a, const NodeId& b) {
+                  return NodeId::compareDistance(a, b, target) < 0;
+                });
+      result.assign(sorted.begin(), sorted.begin() + k);
+    });
+    measure("NodeIdTable::closest", [&] {
+      NodeIdTable table;
+      table.reserve(count);
+      for (const NodeId& id : ids) table.add(id);
+      result.clear();
+      for (size_t index : table.closest(target, k)) {
+        result.push_back(ids[index]);
+      }
+    });
+  }
+}
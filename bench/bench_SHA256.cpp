@@ -0,0 +1,78 @@
+// Run from the repository root:
+//   g++ -std=c++20 -O2 bench/bench_SHA256.cpp -o bench_SHA256 && ./bench_SHA256
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/SHA256Batch.hpp"
+#include "../include/sha256.h"
+
+// Run `fn` repeatedly for about half a second and report hashes/s, where
+// each call hashes `count` messages
+template <typename F>
+static void measure(const std::string& name, size_t count, F fn) {
+  using clock = std::chrono::steady_clock;
+  size_t iterations = 0;
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    fn();
+    iterations++;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < 0.5);
+  double rate = count * iterations / elapsed.count();
+  std::cout << std::left << std::setw(32) << name << std::right
+            << std::setw(14) << std::fixed << std::setprecision(0) << rate
+            << " hashes/s" << std::endl;
+}
+
+static void run(const std::string& label, size_t size, size_t count) {
+  std::string data(size * count, '\0');
+  for (size_t i = 0; i < data.size(); i++) data[i] = char(i * 131 + 7);
+  std::vector<std::string_view> messages;
+  for (size_t i = 0; i < count; i++) {
+    messages.push_back(std::string_view(data).substr(i * size, size));
+  }
+  std::vector<SHA256Batch::Digest> out(count);
+
+  std::cout << label << std::endl;
+  measure("SHA256 scalar", count, [&] {
+    for (size_t i = 0; i < count; i++) {
+      SHA256 sha(false);
+      sha.update(messages[i]);
+      out[i] = sha.digest();
+    }
+  });
+  if (SHA256::hardwareAccelerated()) {
+    measure("SHA256 SHA-NI", count, [&] {
+      for (size_t i = 0; i < count; i++) {
+        SHA256 sha;
+        sha.update(messages[i]);
+        out[i] = sha.digest();
+      }
+    });
+  }
+  using Kernel = SHA256Batch::Kernel;
+  measure("SHA256Batch scalar", count, [&] {
+    SHA256Batch::hash(messages.data(), count, out.data(), Kernel::Scalar);
+  });
+  measure("SHA256Batch SSE2 x4", count, [&] {
+    SHA256Batch::hash(messages.data(), count, out.data(), Kernel::SSE2);
+  });
+  if (__builtin_cpu_supports("avx2")) {
+    measure("SHA256Batch AVX2 x8", count, [&] {
+      SHA256Batch::hash(messages.data(), count, out.data(), Kernel::AVX2);
+    });
+  }
+}
+
+int main() {
+  // Pairs of child hashes, as when building Merkle trees
+  run("64-byte messages", 64, 4096);
+  // Node IDs from "ip:port"
+  run("21-byte messages", 21, 4096);
+  // v2 Merkle leaves
+  run("16 KiB messages", 16384, 64);
+}
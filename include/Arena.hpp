@@ -0,0 +1,90 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Monotonic bump allocator. Memory is released all at once by reset(), so a
+// reused arena stops touching the heap once it has grown to fit the biggest
+// document it has seen.
+class Arena {
+ public:
+  explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena() { release(); }
+
+  // Uninitialized storage for `count` objects of a trivially destructible type
+  template <typename T>
+  T* allocate(size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Arena never runs destructors");
+    return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+  }
+
+  void* allocateBytes(size_t bytes, size_t alignment) {
+    if (head) {
+      uintptr_t base = reinterpret_cast<uintptr_t>(head->data());
+      uintptr_t aligned = (base + used + alignment - 1) & ~(alignment - 1);
+      if (aligned + bytes <= base + head->size) {
+        used = aligned - base + bytes;
+        return reinterpret_cast<void*>(aligned);
+      }
+    }
+    size_t size = bytes + alignment > blockSize ? bytes + alignment : blockSize;
+    Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+    block->size = size;
+    block->next = head;
+    head = block;
+    blockAllocations++;
+    uintptr_t base = reinterpret_cast<uintptr_t>(head->data());
+    uintptr_t aligned = (base + alignment - 1) & ~(alignment - 1);
+    used = aligned - base + bytes;
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  // Invalidate everything allocated so far. If the arena had to grow, its
+  // blocks are merged into one big enough for all of it, so the same
+  // workload fits without further heap allocations next time.
+  void reset() {
+    if (head && head->next) {
+      size_t total = 0;
+      for (Block* b = head; b; b = b->next) total += b->size;
+      release();
+      blockSize = total > blockSize ? total : blockSize;
+      allocateBytes(0, 1);
+    }
+    used = 0;
+  }
+
+  // Number of heap allocations made over the arena's lifetime
+  size_t heapAllocations() const { return blockAllocations; }
+
+ private:
+  struct Block {
+    Block* next;
+    size_t size;
+    std::byte* data() { return reinterpret_cast<std::byte*>(this + 1); }
+  };
+
+  void release() {
+    for (Block* b = head; b;) {
+      Block* next = b->next;
+      ::operator delete(b);
+      b = next;
+    }
+    head = nullptr;
+  }
+
+  Block* head = nullptr;
+  size_t used = 0;  // Bytes used in the head block
+  size_t blockSize;
+  size_t blockAllocations = 0;
+};
+
+#endif
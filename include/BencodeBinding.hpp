@@ -0,0 +1,279 @@
+#ifndef BENCODE_BINDING_HPP
+#define BENCODE_BINDING_HPP
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "TorrentParser.hpp"
+
+// One dictionary entry of a bound struct: its Bencode key and the member
+// it maps to. Members of type std::optional<T> may be absent; every other
+// field is required.
+template <typename T, typename M>
+struct BencodeField {
+  std::string_view key;
+  M T::*member;
+};
+
+template <typename T, typename M>
+constexpr BencodeField<T, M> bencodeField(std::string_view key, M T::*member) {
+  return {key, member};
+}
+
+// Specialize for a struct to bind it to a Bencode dictionary, listing its
+// fields in canonical (sorted) key order:
+//
+//   template <>
+//   struct BencodeFields<Peer> {
+//     static constexpr auto fields =
+//         std::make_tuple(bencodeField("id", &Peer::id),
+//                         bencodeField("ip", &Peer::ip),
+//                         bencodeField("port", &Peer::port));
+//   };
+template <typename T>
+struct BencodeFields;
+
+// Decode and encode bound structs directly from and to Bencode, with no
+// intermediate BencodeValue tree. Supported member types are integers,
+// std::string, std::string_view (a view into the decoded buffer),
+// std::array<uint8_t, N> (a string of exactly N bytes), std::vector,
+// std::optional and other bound structs. Unknown keys are skipped by length.
+class BencodeBinding {
+ public:
+  template <typename T>
+  static T decode(std::string_view data) {
+    T value{};
+    size_t pos = 0;
+    decodeValue(data, pos, value);
+    return value;
+  }
+
+  template <typename T>
+  static std::string encode(const T& value) {
+    std::string out;
+    encode(value, out);
+    return out;
+  }
+
+  // Encode into `out`, reusing its capacity
+  template <typename T>
+  static void encode(const T& value, std::string& out) {
+    out.resize(encodeValue(value, Counter{}).count);
+    encodeValue(value, out.data());
+  }
+
+ private:
+  template <typename T>
+  static constexpr bool isBound = requires { BencodeFields<T>::fields; };
+
+  template <typename T>
+  struct isOptional : std::false_type {};
+  template <typename T>
+  struct isOptional<std::optional<T>> : std::true_type {};
+
+  template <typename T>
+  struct isVector : std::false_type {};
+  template <typename T, typename A>
+  struct isVector<std::vector<T, A>> : std::true_type {};
+
+  template <typename T>
+  struct isByteArray : std::false_type {};
+  template <size_t N>
+  struct isByteArray<std::array<uint8_t, N>> : std::true_type {};
+
+  template <typename T>
+  static constexpr bool keysSorted() {
+    return std::apply(
+        [](const auto&... field) {
+          std::string_view keys[] = {std::string_view(), field.key...};
+          for (size_t i = 2; i < sizeof...(field) + 1; i++) {
+            if (!(keys[i - 1] < keys[i])) return false;
+          }
+          return true;
+        },
+        BencodeFields<T>::fields);
+  }
+
+  // Output iterator that only counts, so sizing and writing share one path
+  struct Counter {
+    size_t count = 0;
+    Counter& operator*() { return *this; }
+    Counter& operator++() {
+      count++;
+      return *this;
+    }
+    Counter operator++(int) {
+      Counter old = *this;
+      count++;
+      return old;
+    }
+    Counter& operator=(char) { return *this; }
+  };
+
+  template <typename Out>
+  static Out write(std::string_view bytes, Out out) {
+    if constexpr (std::is_same_v<Out, Counter>) {
+      out.count += bytes.size();
+      return out;
+    } else {
+      return std::copy(bytes.begin(), bytes.end(), out);
+    }
+  }
+
+  template <typename Out>
+  static Out writeString(std::string_view str, Out out) {
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), str.size()).ptr;
+    out = write(std::string_view(digits, end - digits), out);
+    *out++ = ':';
+    return write(str, out);
+  }
+
+  template <typename T>
+  static void decodeValue(std::string_view data, size_t& pos, T& out) {
+    if (pos >= data.size())
+      throw std::invalid_argument("Unexpected end of Bencode data");
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+      if (data[pos] != 'i')
+        throw std::invalid_argument("Expected a Bencode integer");
+      int64_t value = Bencoder::parseInteger(data, pos);
+      if (!std::in_range<T>(value))
+        throw std::invalid_argument("Bencode integer out of range");
+      out = static_cast<T>(value);
+    } else if constexpr (std::is_same_v<T, std::string> ||
+                         std::is_same_v<T, std::string_view>) {
+      out = T(Bencoder::parseString(data, pos));
+    } else if constexpr (isByteArray<T>::value) {
+      std::string_view bytes = Bencoder::parseString(data, pos);
+      if (bytes.size() != out.size())
+        throw std::invalid_argument("Bencode string has the wrong length");
+      std::copy(bytes.begin(), bytes.end(), out.begin());
+    } else if constexpr (isOptional<T>::value) {
+      decodeValue(data, pos, out.emplace());
+    } else if constexpr (isVector<T>::value) {
+      if (data[pos] != 'l')
+        throw std::invalid_argument("Expected a Bencode list");
+      pos++;
+      out.clear();
+      while (pos < data.size() && data[pos] != 'e') {
+        decodeValue(data, pos, out.emplace_back());
+      }
+      if (pos == data.size()) throw std::invalid_argument("Unterminated list");
+      pos++;
+    } else {
+      static_assert(isBound<T>, "Type has no BencodeFields specialization");
+      decodeStruct(data, pos, out);
+    }
+  }
+
+  template <typename T>
+  static void decodeStruct(std::string_view data, size_t& pos, T& out) {
+    static_assert(keysSorted<T>(),
+                  "BencodeFields must be listed in sorted key order");
+    static_assert(
+        std::tuple_size_v<decltype(BencodeFields<T>::fields)> <= 64,
+        "Too many Bencode fields");
+
+    if (data[pos] != 'd')
+      throw std::invalid_argument("Expected a Bencode dictionary");
+    pos++;
+    uint64_t seen = 0;
+    while (pos < data.size() && data[pos] != 'e') {
+      std::string_view key = Bencoder::parseString(data, pos);
+      bool matched = std::apply(
+          [&](const auto&... field) {
+            size_t i = 0;
+            return ((field.key == key
+                         ? (decodeValue(data, pos, out.*(field.member)),
+                            seen |= uint64_t{1} << i, true)
+                         : (i++, false)) ||
+                    ...);
+          },
+          BencodeFields<T>::fields);
+      if (!matched) Bencoder::skipValue(data, pos);
+    }
+    if (pos == data.size())
+      throw std::invalid_argument("Unterminated dictionary");
+    pos++;
+
+    std::apply(
+        [&](const auto&... field) {
+          size_t i = 0;
+          (checkPresent(field, seen, i++), ...);
+        },
+        BencodeFields<T>::fields);
+  }
+
+  template <typename T, typename M>
+  static void checkPresent(const BencodeField<T, M>& field, uint64_t seen,
+                           size_t i) {
+    if (!isOptional<M>::value && !(seen >> i & 1))
+      throw std::invalid_argument("Missing Bencode key: " +
+                                  std::string(field.key));
+  }
+
+  template <typename T, typename Out>
+  static Out encodeValue(const T& value, Out out) {
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+      // Bencode integers are read back as int64_t
+      if (!std::in_range<int64_t>(value))
+        throw std::invalid_argument("Bencode integer out of range");
+      char digits[24];
+      char* end = std::to_chars(digits, digits + sizeof(digits),
+                                static_cast<int64_t>(value))
+                      .ptr;
+      *out++ = 'i';
+      out = write(std::string_view(digits, end - digits), out);
+      *out++ = 'e';
+      return out;
+    } else if constexpr (std::is_same_v<T, std::string> ||
+                         std::is_same_v<T, std::string_view>) {
+      return writeString(value, out);
+    } else if constexpr (isByteArray<T>::value) {
+      return writeString(
+          std::string_view(reinterpret_cast<const char*>(value.data()),
+                           value.size()),
+          out);
+    } else if constexpr (isOptional<T>::value) {
+      return value ? encodeValue(*value, out) : out;
+    } else if constexpr (isVector<T>::value) {
+      *out++ = 'l';
+      for (const auto& item : value) out = encodeValue(item, out);
+      *out++ = 'e';
+      return out;
+    } else {
+      static_assert(isBound<T>, "Type has no BencodeFields specialization");
+      static_assert(keysSorted<T>(),
+                    "BencodeFields must be listed in sorted key order");
+      *out++ = 'd';
+      std::apply(
+          [&](const auto&... field) {
+            ((out = encodeField(value.*(field.member), field.key, out)), ...);
+          },
+          BencodeFields<T>::fields);
+      *out++ = 'e';
+      return out;
+    }
+  }
+
+  template <typename M, typename Out>
+  static Out encodeField(const M& member, std::string_view key, Out out) {
+    if constexpr (isOptional<M>::value) {
+      if (!member) return out;
+    }
+    return encodeValue(member, writeString(key, out));
+  }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef BENCODE_PARALLEL_HPP
+#define BENCODE_PARALLEL_HPP
+
+#include <string_view>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "TorrentParser.hpp"
+
+// Decoder for very large documents, such as torrents with hundreds of
+// thousands of entries in info.files. The top levels of the document are
+// walked on the calling thread; any list or dictionary there with at least
+// `minElements` entries is split by a fast skip pass into element spans,
+// and the spans are decoded concurrently on the pool straight into their
+// final slots, so the result needs no stitching. Strings are views into the
+// input, exactly as with Bencoder::decodeView.
+class ParallelDecoder {
+ public:
+  explicit ParallelDecoder(ThreadPool& pool, size_t minElements = 4096,
+                           size_t searchDepth = 3)
+      : pool(pool), minElements(minElements), searchDepth(searchDepth) {}
+
+  // Must not be called from a task running on the same pool
+  BencodeView decode(std::string_view data) {
+    size_t pos = 0;
+    return decodeNode(data, pos, 0);
+  }
+
+ private:
+  BencodeView decodeNode(std::string_view data, size_t& pos, size_t depth) {
+    if (pos >= data.size())
+      throw std::invalid_argument("Unexpected end of Bencode data");
+    char c = data[pos];
+    if (depth >= searchDepth || (c != 'l' && c != 'd')) {
+      Bencoder bencoder;
+      size_t begin = pos;
+      Bencoder::skipValue(data, pos);
+      return bencoder.decodeView(data.substr(begin, pos - begin));
+    }
+
+    // Locate every element (and key) without decoding anything
+    bool dict = c == 'd';
+    std::vector<size_t> starts;
+    std::vector<std::string_view> keys;
+    size_t p = pos + 1;
+    while (p < data.size() && data[p] != 'e') {
+      if (dict) {
+        if (!std::isdigit(static_cast<unsigned char>(data[p])))
+          throw std::invalid_argument("Invalid Bencode dictionary key type");
+        keys.push_back(Bencoder::parseString(data, p));
+      }
+      starts.push_back(p);
+      Bencoder::skipValue(data, p);
+    }
+    if (p == data.size())
+      throw std::invalid_argument(dict ? "Unterminated dictionary"
+                                       : "Unterminated list");
+    pos = p + 1;
+
+    std::vector<BencodeView> values(starts.size());
+    if (starts.size() >= minElements && pool.size() > 1) {
+      pool.parallelFor(starts.size(), minElements / 4,
+                       [&](size_t begin, size_t end) {
+                         Bencoder bencoder;
+                         for (size_t i = begin; i < end; i++) {
+                           values[i] =
+                               bencoder.decodeView(data.substr(starts[i]));
+                         }
+                       });
+    } else {
+      for (size_t i = 0; i < starts.size(); i++) {
+        size_t at = starts[i];
+        values[i] = decodeNode(data, at, depth + 1);
+      }
+    }
+
+    if (!dict) return BencodeView::List(std::move(values));
+    BencodeView::Dict result;
+    result.reserve(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+      result.emplace_back(keys[i], std::move(values[i]));
+    }
+    return result;
+  }
+
+  ThreadPool& pool;
+  size_t minElements;
+  size_t searchDepth;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef BENCODE_QUERY_HPP
+#define BENCODE_QUERY_HPP
+
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+#include "TorrentParser.hpp"
+
+// Lazy accessor over undecoded Bencode. A cursor is just a position in the
+// buffer; lookups walk the raw bytes on demand and skip every subtree they
+// do not need by its length prefix, so no DOM is ever built and results are
+// views into the buffer.
+//
+//   BencodeCursor torrent(file.view());
+//   auto name = torrent.path("info.name");
+//   auto size = torrent.path("info.files[3].length");
+class BencodeCursor {
+ public:
+  explicit BencodeCursor(std::string_view data, size_t pos = 0)
+      : data(data), pos(pos) {
+    if (pos >= data.size())
+      throw std::invalid_argument("Unexpected end of Bencode data");
+  }
+
+  bool isInteger() const { return data[pos] == 'i'; }
+  bool isString() const {
+    return std::isdigit(static_cast<unsigned char>(data[pos]));
+  }
+  bool isList() const { return data[pos] == 'l'; }
+  bool isDict() const { return data[pos] == 'd'; }
+
+  int64_t asInteger() const {
+    if (!isInteger())
+      throw std::invalid_argument("Bencode value is not an integer");
+    size_t p = pos;
+    return Bencoder::parseInteger(data, p);
+  }
+
+  std::string_view asString() const {
+    if (!isString())
+      throw std::invalid_argument("Bencode value is not a string");
+    size_t p = pos;
+    return Bencoder::parseString(data, p);
+  }
+
+  // The encoded bytes of this value
+  std::string_view raw() const {
+    size_t end = pos;
+    Bencoder::skipValue(data, end);
+    return data.substr(pos, end - pos);
+  }
+
+  // Value stored under `key` if this is a dictionary
+  std::optional<BencodeCursor> find(std::string_view key) const {
+    if (!isDict()) return std::nullopt;
+    size_t p = pos + 1;
+    while (p < data.size() && data[p] != 'e') {
+      std::string_view k = Bencoder::parseString(data, p);
+      if (k == key) return BencodeCursor(data, p);
+      Bencoder::skipValue(data, p);
+    }
+    return std::nullopt;
+  }
+
+  // Element `index` if this is a list
+  std::optional<BencodeCursor> at(size_t index) const {
+    if (!isList()) return std::nullopt;
+    size_t p = pos + 1;
+    for (; p < data.size() && data[p] != 'e'; index--) {
+      if (index == 0) return BencodeCursor(data, p);
+      Bencoder::skipValue(data, p);
+    }
+    return std::nullopt;
+  }
+
+  // Number of list elements or dictionary pairs, counted by skipping
+  size_t size() const {
+    if (!isList() && !isDict()) return 0;
+    size_t count = 0, p = pos + 1;
+    while (p < data.size() && data[p] != 'e') {
+      if (isDict()) Bencoder::parseString(data, p);
+      Bencoder::skipValue(data, p);
+      count++;
+    }
+    return count;
+  }
+
+  // Resolve a path of dictionary keys separated by '.', each optionally
+  // followed by list indices in brackets: "info.files[3].path[0]". Keys
+  // containing '.' or '[' have to be looked up with find() instead.
+  std::optional<BencodeCursor> path(std::string_view path) const {
+    std::optional<BencodeCursor> cursor = *this;
+    size_t i = 0;
+    while (cursor && i < path.size()) {
+      if (path[i] == '.') {
+        i++;
+      } else if (path[i] == '[') {
+        size_t close = path.find(']', i);
+        if (close == std::string_view::npos)
+          throw std::invalid_argument("Unterminated index in Bencode path");
+        size_t index = 0;
+        auto [end, ec] = std::from_chars(path.data() + i + 1,
+                                         path.data() + close, index);
+        if (ec != std::errc() || end != path.data() + close)
+          throw std::invalid_argument("Invalid index in Bencode path");
+        cursor = cursor->at(index);
+        i = close + 1;
+      } else {
+        size_t end = path.find_first_of(".[", i);
+        if (end == std::string_view::npos) end = path.size();
+        cursor = cursor->find(path.substr(i, end - i));
+        i = end;
+      }
+    }
+    return cursor;
+  }
+
+ private:
+  std::string_view data;
+  size_t pos;
+};
+
+#endif
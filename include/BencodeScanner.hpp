@@ -0,0 +1,177 @@
+#ifndef BENCODE_SCANNER_HPP
+#define BENCODE_SCANNER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BENCODE_SCANNER_X86 1
+#endif
+
+// Bitmaps of the structural bytes ':' (end of a length prefix) and 'e' (end
+// of an integer or container), one bit per input byte, built in 64-byte
+// blocks with the widest vector unit the CPU supports. Decoders use them to
+// jump to the next terminator with a bit scan instead of a byte loop.
+//
+// Blocks are scanned on first use, a few at a time, so the megabytes of piece
+// hashes a decoder skips by length prefix are never scanned at all; build()
+// scans everything up front instead.
+class StructuralIndex {
+ public:
+  enum class Kernel { Auto, Scalar, SSE2, AVX2 };
+
+  static constexpr size_t npos = std::string_view::npos;
+
+  // Index `data` lazily; storage is reused between calls
+  void reset(std::string_view data, Kernel kernel = Kernel::Auto) {
+    bytes = reinterpret_cast<const uint8_t*>(data.data());
+    size = data.size();
+    words = (size + 63) / 64;
+    colons.resize(words);
+    ends.resize(words);
+    scanned.assign((words + 63) / 64, 0);
+    this->kernel = kernel == Kernel::Auto ? bestKernel() : kernel;
+  }
+
+  // Index all of `data` in one pass
+  void build(std::string_view data, Kernel kernel = Kernel::Auto) {
+    reset(data, kernel);
+    scan(0, words);
+  }
+
+  // Position of the next ':' / 'e' at or after pos, npos if there is none
+  size_t nextColon(size_t pos) { return next(colons, pos); }
+  size_t nextEnd(size_t pos) { return next(ends, pos); }
+
+  static Kernel bestKernel() {
+#ifdef BENCODE_SCANNER_X86
+    static const Kernel best = __builtin_cpu_supports("avx2")   ? Kernel::AVX2
+                               : __builtin_cpu_supports("sse2") ? Kernel::SSE2
+                                                                : Kernel::Scalar;
+    return best;
+#else
+    return Kernel::Scalar;
+#endif
+  }
+
+ private:
+  static constexpr size_t blocksPerScan = 4;
+
+  size_t next(const std::vector<uint64_t>& bits, size_t pos) {
+    if (pos >= size) return npos;
+    size_t word = pos / 64;
+    ensure(word);
+    uint64_t w = bits[word] & (~uint64_t{0} << (pos % 64));
+    while (w == 0) {
+      if (++word == words) return npos;
+      ensure(word);
+      w = bits[word];
+    }
+    return word * 64 + __builtin_ctzll(w);
+  }
+
+  void ensure(size_t word) {
+    if (!(scanned[word / 64] >> (word % 64) & 1))
+      scan(word, std::min(word + blocksPerScan, words));
+  }
+
+  // Fill the bitmaps for blocks [first, last)
+  void scan(size_t first, size_t last) {
+    size_t full = std::min(last, size / 64);
+    if (first < full) {
+      switch (kernel) {
+#ifdef BENCODE_SCANNER_X86
+        case Kernel::AVX2:
+          scanAVX2(bytes + first * 64, full - first, colons.data() + first,
+                   ends.data() + first);
+          break;
+        case Kernel::SSE2:
+          scanSSE2(bytes + first * 64, full - first, colons.data() + first,
+                   ends.data() + first);
+          break;
+#endif
+        default:
+          scanScalar(bytes + first * 64, full - first, colons.data() + first,
+                     ends.data() + first);
+          break;
+      }
+    }
+    // Pad the last partial block so the kernels never read past the input
+    if (last > full && size % 64) {
+      uint8_t tail[64] = {0};
+      std::memcpy(tail, bytes + full * 64, size % 64);
+      scanScalar(tail, 1, colons.data() + full, ends.data() + full);
+    }
+    for (size_t w = first; w < last; w++) {
+      scanned[w / 64] |= uint64_t{1} << (w % 64);
+    }
+  }
+
+  static void scanScalar(const uint8_t* data, size_t blocks, uint64_t* colons,
+                         uint64_t* ends) {
+    for (size_t b = 0; b < blocks; b++) {
+      uint64_t c = 0, e = 0;
+      for (size_t i = 0; i < 64; i++) {
+        c |= uint64_t{data[b * 64 + i] == ':'} << i;
+        e |= uint64_t{data[b * 64 + i] == 'e'} << i;
+      }
+      colons[b] = c;
+      ends[b] = e;
+    }
+  }
+
+#ifdef BENCODE_SCANNER_X86
+  __attribute__((target("sse2"))) static void scanSSE2(const uint8_t* data,
+                                                       size_t blocks,
+                                                       uint64_t* colons,
+                                                       uint64_t* ends) {
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i end = _mm_set1_epi8('e');
+    for (size_t b = 0; b < blocks; b++) {
+      uint64_t c = 0, e = 0;
+      for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + b * 64 + i * 16));
+        c |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, colon))))
+             << (i * 16);
+        e |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, end))))
+             << (i * 16);
+      }
+      colons[b] = c;
+      ends[b] = e;
+    }
+  }
+
+  __attribute__((target("avx2"))) static void scanAVX2(const uint8_t* data,
+                                                       size_t blocks,
+                                                       uint64_t* colons,
+                                                       uint64_t* ends) {
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i end = _mm256_set1_epi8('e');
+    for (size_t b = 0; b < blocks; b++) {
+      __m256i lo =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + b * 64));
+      __m256i hi = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(data + b * 64 + 32));
+      uint32_t cLo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, colon));
+      uint32_t cHi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, colon));
+      uint32_t eLo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, end));
+      uint32_t eHi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, end));
+      colons[b] = uint64_t(cHi) << 32 | cLo;
+      ends[b] = uint64_t(eHi) << 32 | eLo;
+    }
+  }
+#endif
+
+  std::vector<uint64_t> colons, ends;
+  std::vector<uint64_t> scanned;  // One bit per block
+  const uint8_t* bytes = nullptr;
+  size_t size = 0, words = 0;
+  Kernel kernel = Kernel::Scalar;
+};
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef BENCODE_STREAM_HPP
+#define BENCODE_STREAM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "TorrentParser.hpp"
+
+// Receiver of SAX-style Bencode events. String bytes are delivered as they
+// arrive, so a string split across chunks produces several onStringData
+// calls between onStringBegin and onStringEnd; the views are only valid for
+// the duration of the call.
+class BencodeHandler {
+ public:
+  virtual ~BencodeHandler() = default;
+  virtual void onInteger(int64_t value) = 0;
+  virtual void onStringBegin(uint64_t length) = 0;
+  virtual void onStringData(std::string_view data) = 0;
+  virtual void onStringEnd() = 0;
+  virtual void onListBegin() = 0;
+  virtual void onListEnd() = 0;
+  virtual void onDictBegin() = 0;
+  virtual void onDictEnd() = 0;
+};
+
+// Resumable push decoder: feed() accepts arbitrary chunks of a Bencode
+// document straight from a receive buffer, emits events as soon as they are
+// decidable and reports how many bytes it consumed. Nothing is buffered; the
+// only state kept between chunks is a partial number and the container stack.
+class BencodeStreamDecoder {
+ public:
+  explicit BencodeStreamDecoder(BencodeHandler& handler, size_t maxDepth = 256)
+      : handler(handler), maxDepth(maxDepth) {}
+
+  // Consume bytes from `chunk` up to the end of the document. Returns the
+  // number of bytes used; anything past the end of the document is left for
+  // the caller.
+  size_t feed(std::string_view chunk) {
+    size_t pos = 0;
+    while (pos < chunk.size() && state != State::Done) {
+      char c = chunk[pos];
+      switch (state) {
+        case State::Value:
+          pos++;
+          startValue(c);
+          break;
+        case State::IntegerSign:
+          if (c == '-') {
+            negative = true;
+            pos++;
+            state = State::IntegerDigits;
+            break;
+          }
+          state = State::IntegerDigits;
+          [[fallthrough]];
+        case State::IntegerDigits:
+          pos++;
+          if (c == 'e') {
+            if (digits == 0)
+              throw std::invalid_argument("Invalid Bencode integer format");
+            handler.onInteger(negative ? static_cast<int64_t>(0 - number)
+                                       : static_cast<int64_t>(number));
+            valueDone();
+          } else {
+            uint64_t limit = uint64_t(std::numeric_limits<int64_t>::max()) +
+                             (negative ? 1 : 0);
+            addDigit(c, limit, "Invalid Bencode integer format");
+          }
+          break;
+        case State::Length:
+          pos++;
+          if (c == ':') {
+            handler.onStringBegin(number);
+            if (number == 0) {
+              handler.onStringEnd();
+              valueDone();
+            } else {
+              state = State::StringBody;
+            }
+          } else {
+            addDigit(c, std::numeric_limits<uint64_t>::max(),
+                     "Invalid Bencode string format");
+          }
+          break;
+        case State::StringBody: {
+          size_t take = static_cast<size_t>(
+              std::min<uint64_t>(number, chunk.size() - pos));
+          handler.onStringData(chunk.substr(pos, take));
+          pos += take;
+          number -= take;
+          if (number == 0) {
+            handler.onStringEnd();
+            valueDone();
+          }
+          break;
+        }
+        case State::Done:
+          break;
+      }
+    }
+    consumed += pos;
+    return pos;
+  }
+
+  bool done() const { return state == State::Done; }
+  // Total bytes consumed since construction or the last reset()
+  size_t bytesConsumed() const { return consumed; }
+
+  // Start over for the next document
+  void reset() {
+    state = State::Value;
+    frames.clear();
+    consumed = 0;
+  }
+
+ private:
+  enum class State {
+    Value,
+    IntegerSign,
+    IntegerDigits,
+    Length,
+    StringBody,
+    Done
+  };
+
+  struct Frame {
+    bool dict;
+    bool expectKey;
+  };
+
+  void startValue(char c) {
+    Frame* top = frames.empty() ? nullptr : &frames.back();
+    if (top && c == 'e') {
+      if (top->dict && !top->expectKey)
+        throw std::invalid_argument("Missing Bencode dictionary value");
+      bool dict = top->dict;
+      frames.pop_back();
+      dict ? handler.onDictEnd() : handler.onListEnd();
+      valueDone();
+      return;
+    }
+    if (top && top->dict && top->expectKey && (c < '0' || c > '9'))
+      throw std::invalid_argument("Invalid Bencode dictionary key type");
+
+    number = 0;
+    digits = 0;
+    negative = false;
+    if (c == 'i') {
+      state = State::IntegerSign;
+    } else if (c == 'l' || c == 'd') {
+      if (frames.size() == maxDepth)
+        throw std::invalid_argument("Bencode nesting too deep");
+      frames.push_back({c == 'd', c == 'd'});
+      c == 'd' ? handler.onDictBegin() : handler.onListBegin();
+    } else if (c >= '0' && c <= '9') {
+      state = State::Length;
+      addDigit(c, std::numeric_limits<uint64_t>::max(), "");
+    } else {
+      throw std::invalid_argument("Invalid Bencode format");
+    }
+  }
+
+  void addDigit(char c, uint64_t limit, const char* error) {
+    if (c < '0' || c > '9') throw std::invalid_argument(error);
+    uint64_t d = static_cast<uint64_t>(c - '0');
+    if (number > (limit - d) / 10) throw std::invalid_argument(error);
+    number = number * 10 + d;
+    digits++;
+  }
+
+  // A complete value has been emitted
+  void valueDone() {
+    state = State::Value;
+    if (frames.empty()) {
+      state = State::Done;
+    } else if (frames.back().dict) {
+      frames.back().expectKey = !frames.back().expectKey;
+    }
+  }
+
+  BencodeHandler& handler;
+  size_t maxDepth;
+  std::vector<Frame> frames;
+  State state = State::Value;
+  uint64_t number = 0;  // Integer magnitude, string length or bytes left
+  size_t digits = 0;
+  bool negative = false;
+  size_t consumed = 0;
+};
+
+// Handler that assembles the events into a BencodeValue
+class BencodeValueBuilder : public BencodeHandler {
+ public:
+  void onInteger(int64_t value) override { add(value); }
+  void onStringBegin(uint64_t length) override {
+    text.clear();
+    // The length is untrusted until the bytes actually arrive
+    text.reserve(static_cast<size_t>(std::min<uint64_t>(length, 1 << 20)));
+  }
+  void onStringData(std::string_view data) override { text.append(data); }
+  void onStringEnd() override { add(std::move(text)); }
+  void onListBegin() override { open(std::vector<BencodeValue>{}); }
+  void onListEnd() override { close(); }
+  void onDictBegin() override {
+    open(std::map<BencodeValue::KeyType, BencodeValue>{});
+  }
+  void onDictEnd() override { close(); }
+
+  // The finished document, once the decoder reports done()
+  std::optional<BencodeValue>& result() { return document; }
+
+ private:
+  struct Open {
+    BencodeValue value;
+    std::optional<std::string> key;  // Dicts: key awaiting its value
+  };
+
+  void open(BencodeValue container) {
+    stack.push_back({std::move(container), std::nullopt});
+  }
+
+  void close() {
+    BencodeValue value = std::move(stack.back().value);
+    stack.pop_back();
+    add(std::move(value));
+  }
+
+  void add(BencodeValue value) {
+    if (stack.empty()) {
+      document = std::move(value);
+      return;
+    }
+    Open& top = stack.back();
+    if (auto* list = std::get_if<std::vector<BencodeValue>>(&top.value.value)) {
+      list->push_back(std::move(value));
+    } else if (!top.key) {
+      top.key = std::get<std::string>(value.value);
+    } else {
+      auto& dict = std::get<std::map<BencodeValue::KeyType, BencodeValue>>(
+          top.value.value);
+      dict[std::move(*top.key)] = std::move(value);
+      top.key.reset();
+    }
+  }
+
+  std::vector<Open> stack;
+  std::string text;
+  std::optional<BencodeValue> document;
+};
+
+#endif
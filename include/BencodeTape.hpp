@@ -0,0 +1,359 @@
+#ifndef BENCODE_TAPE_HPP
+#define BENCODE_TAPE_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "Arena.hpp"
+#include "BencodeScanner.hpp"
+#include "TorrentParser.hpp"
+
+// Flat Bencode document: every value is one 16-byte entry on a contiguous
+// tape in pre-order, containers record where their subtree ends so it can be
+// skipped in O(1), and each dictionary owns a slice of a key index sorted by
+// key for binary search. Strings are views into the source buffer; the tape
+// itself lives in an Arena. Both must outlive the document.
+class BencodeTape {
+ public:
+  enum class Type : uint8_t { Integer, String, List, Dict };
+
+  struct Container {
+    uint32_t next;  // Index of the entry following this subtree
+    uint32_t keys;  // Dicts: first slot in the key index
+  };
+
+  struct Entry {
+    Type type;
+    uint32_t size;  // String length, list element count or dict pair count
+    union {
+      int64_t integer;
+      uint32_t offset;  // Strings: position of the bytes in the source
+      Container container;
+    };
+  };
+
+  struct KeySlot {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t value;  // Tape index of the value stored under this key
+  };
+
+  class Node;
+
+  // Iterates over the direct children of a container. For dictionaries the
+  // children alternate between key and value.
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Node;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Node;
+
+    Iterator(const BencodeTape* tape, uint32_t index)
+        : tape(tape), index(index) {}
+    Node operator*() const { return Node(tape, index); }
+    Iterator& operator++() {
+      index = tape->skip(index);
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const Iterator& other) const {
+      return index == other.index;
+    }
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+   private:
+    const BencodeTape* tape;
+    uint32_t index;
+  };
+
+  class Node {
+   public:
+    Node(const BencodeTape* tape, uint32_t index) : tape(tape), index(index) {}
+
+    Type type() const { return entry().type; }
+    bool isInteger() const { return type() == Type::Integer; }
+    bool isString() const { return type() == Type::String; }
+    bool isList() const { return type() == Type::List; }
+    bool isDict() const { return type() == Type::Dict; }
+
+    int64_t asInteger() const {
+      if (!isInteger())
+        throw std::invalid_argument("Bencode value is not an integer");
+      return entry().integer;
+    }
+
+    std::string_view asString() const {
+      if (!isString())
+        throw std::invalid_argument("Bencode value is not a string");
+      return tape->source.substr(entry().offset, entry().size);
+    }
+
+    // Number of list elements or dictionary pairs
+    size_t size() const { return isList() || isDict() ? entry().size : 0; }
+
+    Iterator begin() const { return Iterator(tape, index + 1); }
+    Iterator end() const { return Iterator(tape, tape->skip(index)); }
+
+    // List element by position, walking siblings by their skip offsets
+    Node operator[](size_t i) const {
+      if (!isList() || i >= size())
+        throw std::out_of_range("Bencode list index out of range");
+      auto it = begin();
+      while (i--) ++it;
+      return *it;
+    }
+
+    // Dictionary value by key, by binary search over the sorted key index
+    std::optional<Node> find(std::string_view key) const {
+      if (!isDict()) return std::nullopt;
+      const KeySlot* first = tape->keys + entry().container.keys;
+      const KeySlot* last = first + entry().size;
+      const KeySlot* it = std::lower_bound(
+          first, last, key, [this](const KeySlot& slot, std::string_view k) {
+            return tape->keyOf(slot) < k;
+          });
+      if (it == last || tape->keyOf(*it) != key) return std::nullopt;
+      return Node(tape, it->value);
+    }
+
+    // Copy into an owning BencodeValue
+    BencodeValue toValue() const {
+      switch (type()) {
+        case Type::Integer:
+          return asInteger();
+        case Type::String:
+          return std::string(asString());
+        case Type::List: {
+          std::vector<BencodeValue> list;
+          list.reserve(size());
+          for (Node child : *this) list.push_back(child.toValue());
+          return list;
+        }
+        case Type::Dict:
+        default: {
+          std::map<BencodeValue::KeyType, BencodeValue> dict;
+          for (auto it = begin(); it != end(); ++it) {
+            std::string key((*it).asString());
+            dict[key] = (*++it).toValue();
+          }
+          return dict;
+        }
+      }
+    }
+
+   private:
+    const Entry& entry() const { return tape->entries[index]; }
+
+    const BencodeTape* tape;
+    uint32_t index;
+  };
+
+  Node root() const { return Node(this, 0); }
+  size_t entryCount() const { return count; }
+  // Number of source bytes taken by the document
+  size_t consumed() const { return length; }
+
+ private:
+  friend class TapeDecoder;
+
+  uint32_t skip(uint32_t index) const {
+    const Entry& e = entries[index];
+    return e.type == Type::List || e.type == Type::Dict ? e.container.next
+                                                        : index + 1;
+  }
+
+  std::string_view keyOf(const KeySlot& slot) const {
+    return source.substr(slot.offset, slot.length);
+  }
+
+  std::string_view source;
+  const Entry* entries = nullptr;
+  const KeySlot* keys = nullptr;
+  uint32_t count = 0;
+  size_t length = 0;
+};
+
+// Iterative, depth-limited decoder producing a BencodeTape. A first pass
+// validates the input and counts entries and keys, so the second pass can
+// fill exactly-sized arrays: a document costs a fixed number of arena
+// allocations regardless of its shape, and nesting depth never touches the
+// call stack. Inputs above a size threshold go through a StructuralIndex so
+// both passes find integer and length-prefix terminators by bit scanning.
+class TapeDecoder {
+ public:
+  explicit TapeDecoder(Arena& arena, size_t maxDepth = 256)
+      : arena(arena), frames(maxDepth) {}
+
+  // Inputs of at least this many bytes are indexed; SIZE_MAX disables it
+  void setIndexThreshold(size_t bytes) { indexThreshold = bytes; }
+
+  BencodeTape decode(std::string_view data) {
+    if (data.size() > std::numeric_limits<uint32_t>::max())
+      throw std::invalid_argument("Bencode document too large");
+    indexed = data.size() >= indexThreshold;
+    if (indexed) structure.reset(data);
+
+    Counts counts = walk<false>(data, {});
+    Output out{arena.allocate<BencodeTape::Entry>(counts.entries),
+               arena.allocate<BencodeTape::KeySlot>(counts.keys),
+               arena.allocate<BencodeTape::KeySlot>(counts.keys)};
+    walk<true>(data, out);
+
+    BencodeTape tape;
+    tape.source = data;
+    tape.entries = out.entries;
+    tape.keys = out.keys;
+    tape.count = counts.entries;
+    tape.length = counts.consumed;
+    return tape;
+  }
+
+ private:
+  struct Frame {
+    uint32_t entry;      // Tape index of the container
+    uint32_t count;      // Elements or pairs seen so far
+    uint32_t keysBegin;  // Dicts: where this dict's keys start on the scratch
+    bool dict;
+    bool expectKey;
+  };
+
+  struct Counts {
+    uint32_t entries = 0;
+    uint32_t keys = 0;
+    size_t consumed = 0;
+  };
+
+  struct Output {
+    BencodeTape::Entry* entries;
+    BencodeTape::KeySlot* keys;
+    BencodeTape::KeySlot* scratch;
+  };
+
+  // Shared by both passes; only the second one writes to `out`
+  template <bool Build>
+  Counts walk(std::string_view data, Output out) {
+    Counts counts;
+    uint32_t keyCursor = 0, scratchTop = 0;
+    size_t depth = 0, pos = 0;
+
+    while (true) {
+      if (pos >= data.size())
+        throw std::invalid_argument("Unexpected end of Bencode data");
+      char c = data[pos];
+      Frame* top = depth > 0 ? &frames[depth - 1] : nullptr;
+
+      if (top && c == 'e') {
+        if (top->dict && !top->expectKey)
+          throw std::invalid_argument("Missing Bencode dictionary value");
+        pos++;
+        if constexpr (Build) {
+          BencodeTape::Entry& e = out.entries[top->entry];
+          e.size = top->count;
+          e.container.next = counts.entries;
+          if (top->dict) {
+            BencodeTape::KeySlot* first = out.keys + keyCursor;
+            std::copy(out.scratch + top->keysBegin, out.scratch + scratchTop,
+                      first);
+            BencodeTape::KeySlot* last = first + (scratchTop - top->keysBegin);
+            auto less = [&data](const BencodeTape::KeySlot& a,
+                                const BencodeTape::KeySlot& b) {
+              return data.substr(a.offset, a.length) <
+                     data.substr(b.offset, b.length);
+            };
+            if (!std::is_sorted(first, last, less)) std::sort(first, last, less);
+            e.container.keys = keyCursor;
+            keyCursor += top->count;
+            scratchTop = top->keysBegin;
+          }
+        }
+        if (--depth == 0) break;
+        valueDone(frames[depth - 1]);
+        continue;
+      }
+
+      if (top && top->dict && top->expectKey &&
+          !std::isdigit(static_cast<unsigned char>(c)))
+        throw std::invalid_argument("Invalid Bencode dictionary key type");
+
+      uint32_t index = counts.entries++;
+      if (c == 'l' || c == 'd') {
+        if (depth == frames.size())
+          throw std::invalid_argument("Bencode nesting too deep");
+        if constexpr (Build) {
+          out.entries[index].type =
+              c == 'd' ? BencodeTape::Type::Dict : BencodeTape::Type::List;
+        }
+        frames[depth++] = Frame{index, 0, scratchTop, c == 'd', c == 'd'};
+        pos++;
+        continue;
+      } else if (c == 'i') {
+        int64_t value =
+            indexed ? Bencoder::parseInteger(data, pos, structure.nextEnd(pos))
+                    : Bencoder::parseInteger(data, pos);
+        if constexpr (Build) {
+          out.entries[index].type = BencodeTape::Type::Integer;
+          out.entries[index].size = 0;
+          out.entries[index].integer = value;
+        }
+      } else if (std::isdigit(static_cast<unsigned char>(c))) {
+        std::string_view str =
+            indexed ? Bencoder::parseString(data, pos, structure.nextColon(pos))
+                    : Bencoder::parseString(data, pos);
+        uint32_t offset = static_cast<uint32_t>(str.data() - data.data());
+        uint32_t size = static_cast<uint32_t>(str.size());
+        if constexpr (Build) {
+          out.entries[index].type = BencodeTape::Type::String;
+          out.entries[index].size = size;
+          out.entries[index].offset = offset;
+        }
+        if (top && top->dict && top->expectKey) {
+          if constexpr (Build) {
+            out.scratch[scratchTop] = {offset, size, index + 1};
+          }
+          scratchTop++;
+          counts.keys++;
+        }
+      } else {
+        throw std::invalid_argument("Invalid Bencode format");
+      }
+
+      if (!top) break;
+      valueDone(*top);
+    }
+
+    counts.consumed = pos;
+    return counts;
+  }
+
+  static void valueDone(Frame& frame) {
+    if (!frame.dict) {
+      frame.count++;
+    } else if (frame.expectKey) {
+      frame.expectKey = false;
+    } else {
+      frame.expectKey = true;
+      frame.count++;
+    }
+  }
+
+  Arena& arena;
+  std::vector<Frame> frames;
+  StructuralIndex structure;
+  size_t indexThreshold = 1024;
+  bool indexed = false;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef BITFIELD_HPP
+#define BITFIELD_HPP
+
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// One bit per piece, packed as in the BitTorrent "bitfield" message: piece
+// 0 is the high bit of the first byte and spare bits at the end are zero
+class Bitfield {
+ public:
+  Bitfield() = default;
+  explicit Bitfield(size_t size) : bits((size + 7) / 8), count(size) {}
+
+  size_t size() const { return count; }
+
+  bool get(size_t index) const {
+    check(index);
+    return bits[index / 8] & (0x80 >> (index % 8));
+  }
+
+  void set(size_t index, bool value = true) {
+    check(index);
+    uint8_t mask = static_cast<uint8_t>(0x80 >> (index % 8));
+    if (value) {
+      bits[index / 8] |= mask;
+    } else {
+      bits[index / 8] &= static_cast<uint8_t>(~mask);
+    }
+  }
+
+  // Number of set bits
+  size_t countSet() const {
+    size_t total = 0;
+    for (uint8_t byte : bits) total += std::popcount(byte);
+    return total;
+  }
+
+  bool all() const { return countSet() == count; }
+
+  // Wire form, (size + 7) / 8 bytes
+  const std::vector<uint8_t>& bytes() const { return bits; }
+
+  bool operator==(const Bitfield& other) const = default;
+
+ private:
+  void check(size_t index) const {
+    if (index >= count) throw std::out_of_range("Bitfield index out of range");
+  }
+
+  std::vector<uint8_t> bits;
+  size_t count = 0;
+};
+
+#endif
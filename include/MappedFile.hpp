@@ -0,0 +1,74 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+      throw std::runtime_error("Cannot open " + path + ": " +
+                               std::strerror(errno));
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+      ::close(fd);
+      throw std::runtime_error("Cannot stat " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+      void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map " + path);
+      }
+      data = static_cast<const char*>(addr);
+    }
+    ::close(fd);  // The mapping keeps its own reference to the file
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept
+      : data(other.data), length(other.length) {
+    other.data = nullptr;
+    other.length = 0;
+  }
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      data = other.data;
+      length = other.length;
+      other.data = nullptr;
+      other.length = 0;
+    }
+    return *this;
+  }
+
+  ~MappedFile() { unmap(); }
+
+  std::string_view view() const { return {data, length}; }
+  size_t size() const { return length; }
+
+ private:
+  void unmap() {
+    if (data) ::munmap(const_cast<char*>(data), length);
+  }
+
+  const char* data = nullptr;
+  size_t length = 0;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef MERKLE_TREE_HPP
+#define MERKLE_TREE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "SHA256Batch.hpp"
+#include "sha256.h"
+
+// BitTorrent v2 (BEP 52) hash tree over one file. Leaves are the SHA-256 of
+// each 16 KiB block; the leaf count is rounded up to a power of two with
+// all-zero leaves, and every inner node is the SHA-256 of its two children.
+// Only the nodes covering real blocks are stored, padding is substituted
+// from a small table of all-zero subtree hashes.
+class MerkleTree {
+ public:
+  using Hash = std::array<uint8_t, 32>;
+
+  static constexpr size_t blockSize = 16 * 1024;
+
+  MerkleTree() : layers(1) {}
+
+  explicit MerkleTree(std::vector<Hash> leaves) {
+    layers.push_back(std::move(leaves));
+    while (layers.back().size() > 1) {
+      layers.push_back(parents(layers.back(), layers.size() - 1));
+    }
+  }
+
+  // Tree over the blocks of a file held in memory
+  static MerkleTree fromData(std::string_view data) {
+    std::vector<Hash> leaves((data.size() + blockSize - 1) / blockSize);
+    hashBlocks(data, leaves.data());
+    return MerkleTree(std::move(leaves));
+  }
+
+  size_t leafCount() const { return layers[0].size(); }
+
+  // Root of the padded tree; the pieces root of a non-empty file
+  Hash root() const { return leafCount() == 0 ? Hash{} : layers.back()[0]; }
+
+  // Hashes of the subtrees spanning `blocksPerPiece` leaves each, as stored
+  // in the "piece layers" dictionary; blocksPerPiece must be a power of two
+  std::vector<Hash> pieceLayer(size_t blocksPerPiece) const {
+    size_t height = log2(blocksPerPiece);
+    if (leafCount() == 0) return {};
+    if (height < layers.size()) return layers[height];
+    // Files smaller than one piece: a single subtree padded up to the piece
+    return {rootOf(layers.back()[0], layers.size() - 1, height)};
+  }
+
+  // Sibling hashes from leaf `index` up to the root, bottom-up
+  std::vector<Hash> proof(size_t index) const {
+    if (index >= leafCount())
+      throw std::out_of_range("Merkle leaf index out of range");
+    std::vector<Hash> siblings;
+    for (size_t height = 0; height + 1 < layers.size(); height++) {
+      size_t sibling = index ^ 1;
+      siblings.push_back(sibling < layers[height].size()
+                             ? layers[height][sibling]
+                             : padHash(height));
+      index /= 2;
+    }
+    return siblings;
+  }
+
+  // Whether `leaf` at position `index` hashes up to `root` through `proof`
+  static bool verify(Hash leaf, size_t index, const std::vector<Hash>& proof,
+                     const Hash& root) {
+    for (const Hash& sibling : proof) {
+      leaf = index & 1 ? combine(sibling, leaf) : combine(leaf, sibling);
+      index /= 2;
+    }
+    return index == 0 && leaf == root;
+  }
+
+  // Root of the subtree with `width` leaves (a power of two) whose first
+  // `count` leaves are `leaves` and the rest zero. Checks a piece's block
+  // hashes against its piece-layer hash, or a small file against its root.
+  static Hash subtreeRoot(const Hash* leaves, size_t count, size_t width) {
+    size_t top = log2(width);
+    if (count > width)
+      throw std::invalid_argument("Too many leaves for Merkle subtree");
+    if (count == 0) return padHash(top);
+    std::vector<Hash> level(leaves, leaves + count);
+    size_t height = 0;
+    for (; level.size() > 1; height++) level = parents(level, height);
+    return rootOf(level[0], height, top);
+  }
+
+  // Root of a file's tree from its piece layer, where each hash covers
+  // 2^height leaves. Used to check "piece layers" against "pieces root".
+  static Hash rootFromLayer(const std::vector<Hash>& layer, size_t height) {
+    if (layer.empty()) return Hash{};
+    std::vector<Hash> level = layer;
+    for (; level.size() > 1; height++) level = parents(level, height);
+    return level[0];
+  }
+
+  static Hash hashBlock(std::string_view block) {
+    SHA256 sha;
+    sha.update(reinterpret_cast<const uint8_t*>(block.data()), block.size());
+    return sha.digest();
+  }
+
+  // Leaves of consecutive blocks of `data`, the last of which may be
+  // short, hashed several at a time with SHA256Batch
+  static void hashBlocks(std::string_view data, Hash* out) {
+    std::string_view blocks[batchSize];
+    for (size_t first = 0; first * blockSize < data.size();
+         first += batchSize) {
+      size_t n = 0;
+      for (; n < batchSize && (first + n) * blockSize < data.size(); n++) {
+        blocks[n] = data.substr((first + n) * blockSize, blockSize);
+      }
+      SHA256Batch::hash(blocks, n, out + first);
+    }
+  }
+
+  static Hash combine(const Hash& left, const Hash& right) {
+    uint8_t pair[64];
+    std::copy(left.begin(), left.end(), pair);
+    std::copy(right.begin(), right.end(), pair + 32);
+    SHA256 sha;
+    sha.update(pair, sizeof(pair));
+    return sha.digest();
+  }
+
+  // Hash of an all-zero subtree 2^height leaves wide
+  static const Hash& padHash(size_t height) {
+    static const std::array<Hash, 64> table = [] {
+      std::array<Hash, 64> t{};
+      for (size_t h = 1; h < t.size(); h++) t[h] = combine(t[h - 1], t[h - 1]);
+      return t;
+    }();
+    return table.at(height);
+  }
+
+  static size_t log2(size_t n) {
+    if (n == 0 || (n & (n - 1)) != 0)
+      throw std::invalid_argument("Merkle width must be a power of two");
+    size_t height = 0;
+    while (n > 1) {
+      n /= 2;
+      height++;
+    }
+    return height;
+  }
+
+ private:
+  // The layer above `below`, which sits `height` levels over the leaves;
+  // a missing right child is the all-zero subtree of that height
+  static std::vector<Hash> parents(const std::vector<Hash>& below,
+                                   size_t height) {
+    std::vector<Hash> above((below.size() + 1) / 2);
+    // Sibling pairs sit next to each other, so each is one 64-byte message
+    size_t pairs = below.size() / 2;
+    std::string_view messages[batchSize];
+    for (size_t first = 0; first < pairs; first += batchSize) {
+      size_t n = std::min(batchSize, pairs - first);
+      for (size_t i = 0; i < n; i++) {
+        messages[i] = std::string_view(
+            reinterpret_cast<const char*>(below[2 * (first + i)].data()),
+            2 * sizeof(Hash));
+      }
+      SHA256Batch::hash(messages, n, above.data() + first);
+    }
+    if (below.size() % 2)
+      above.back() = combine(below.back(), padHash(height));
+    return above;
+  }
+
+  // Extend a subtree root at `from` height with zero siblings up to `to`
+  static Hash rootOf(Hash node, size_t from, size_t to) {
+    for (; from < to; from++) node = combine(node, padHash(from));
+    return node;
+  }
+
+  // Messages handed to SHA256Batch per call
+  static constexpr size_t batchSize = 16;
+
+  std::vector<std::vector<Hash>> layers;
+};
+
+#endif
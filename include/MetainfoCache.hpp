@@ -0,0 +1,519 @@
+#ifndef METAINFO_CACHE_HPP
+#define METAINFO_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "TorrentMetainfo.hpp"
+
+// Binary cache of parsed metainfo, so a restart does not have to decode
+// every .torrent file again. The file is memory-mapped and used in place:
+//
+//   Header
+//   IndexEntry[count]  sorted by info-hash
+//   PathEntry[count]   sorted by hash of the source path
+//   records            one per torrent, 8-byte aligned
+//
+// A record holds a RecordHeader followed by the file table, v2 piece
+// layers, tracker URLs, v1 piece hashes and a string pool, each a flat
+// array. A loaded TorrentMetainfo copies the small file table and strings
+// but views its piece hashes and layers in the mapping, which it keeps
+// alive. The header and indexes are checked when the cache is opened. The
+// index holds a checksum of each record but its piece hashes and layers,
+// verified the first time the record is looked up; the record header holds
+// one of the hashes and layers, verified the first time a piece needs
+// them. Startup thus touches just the small parts of the torrents it
+// loads, once. Entries are tied to the size and modification time of their
+// source file and ignored once it changes.
+// Integers are stored in host byte order; a cache from a host of the
+// other byte order fails the version check.
+class MetainfoCache {
+ public:
+  static constexpr uint32_t formatVersion = 3;
+
+  // Identity of a .torrent file on disk
+  struct Source {
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+
+    // std::nullopt if the file cannot be stat'ed
+    static std::optional<Source> of(const std::string& path) {
+      std::error_code error;
+      uint64_t size = std::filesystem::file_size(path, error);
+      if (error) return std::nullopt;
+      auto time = std::filesystem::last_write_time(path, error);
+      if (error) return std::nullopt;
+      return Source{path, size,
+                    static_cast<int64_t>(time.time_since_epoch().count())};
+    }
+  };
+
+  MetainfoCache() = default;
+
+  // Open the cache at `path`. A missing, truncated, corrupt or outdated
+  // file gives an empty cache rather than an error.
+  explicit MetainfoCache(const std::string& path) {
+    try {
+      file = std::make_shared<const MappedFile>(path);
+    } catch (const std::runtime_error&) {
+      return;
+    }
+    std::string_view data = file->view();
+    Header header;
+    if (data.size() < sizeof(header)) return;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(header.magic)) != 0 ||
+        header.version != formatVersion || header.fileSize != data.size())
+      return;
+    size_t indexBytes =
+        size_t{header.count} * (sizeof(IndexEntry) + sizeof(PathEntry));
+    if (indexBytes > data.size() - sizeof(header) ||
+        fnv1a(data.substr(sizeof(header), indexBytes)) != header.checksum)
+      return;
+    index = reinterpret_cast<const IndexEntry*>(data.data() + sizeof(header));
+    paths = reinterpret_cast<const PathEntry*>(index + header.count);
+    count = header.count;
+    for (size_t i = 0; i < count; i++) {
+      if (index[i].offset > data.size() ||
+          index[i].length > data.size() - index[i].offset ||
+          index[i].length < sizeof(RecordHeader) || index[i].offset % 8 != 0 ||
+          paths[i].entry >= count) {
+        count = 0;
+        return;
+      }
+    }
+    checked = std::make_unique<std::atomic<uint8_t>[]>(count);
+  }
+
+  size_t size() const { return count; }
+
+  // Entry for `source` if the cache has one for the same path, size and
+  // modification time whose record is intact
+  std::optional<size_t> find(const Source& source) const {
+    uint64_t key = fnv1a(source.path);
+    const PathEntry* it = std::lower_bound(
+        paths, paths + count, key,
+        [](const PathEntry& e, uint64_t k) { return e.pathHash < k; });
+    for (; it != paths + count && it->pathHash == key; ++it) {
+      const IndexEntry& entry = index[it->entry];
+      if (entry.sourceSize == source.size &&
+          entry.sourceMtime == source.mtime && intact(it->entry) &&
+          sourcePath(it->entry) == source.path)
+        return it->entry;
+    }
+    return std::nullopt;
+  }
+
+  // Entry for the torrent with this info-hash (see getInfoHashV2)
+  std::optional<size_t> find(const MerkleTree::Hash& infoHash) const {
+    const IndexEntry* it = std::lower_bound(
+        index, index + count, infoHash,
+        [](const IndexEntry& e, const MerkleTree::Hash& h) {
+          return std::memcmp(e.infoHash, h.data(), h.size()) < 0;
+        });
+    if (it == index + count ||
+        std::memcmp(it->infoHash, infoHash.data(), infoHash.size()) != 0 ||
+        !intact(it - index))
+      return std::nullopt;
+    return static_cast<size_t>(it - index);
+  }
+
+  // Rebuild the metainfo of an entry from its record, without decoding.
+  // Its piece hashes and layers stay in the mapping.
+  TorrentMetainfo load(size_t entry) const {
+    std::string_view data = record(entry);
+    RecordHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    Reader reader{data, sizeof(header)};
+    std::string_view strings =
+        data.substr(data.size() - std::min<size_t>(header.stringBytes,
+                                                    data.size()));
+    auto text = [&strings](StringRef ref) {
+      if (ref.offset > strings.size() ||
+          ref.length > strings.size() - ref.offset)
+        throw std::runtime_error("Corrupt metainfo cache record");
+      return std::string(strings.substr(ref.offset, ref.length));
+    };
+
+    TorrentMetainfo meta;
+    meta.name = text(header.name);
+    meta.announce = text(header.announce);
+    meta.comment = text(header.comment);
+    meta.creationDate = header.creationDate;
+    meta.v1 = header.flags & flagV1;
+    meta.v2 = header.flags & flagV2;
+    meta.multiFile = header.flags & flagMultiFile;
+    meta.pieceLength = header.pieceLength;
+    meta.totalLength = header.totalLength;
+    meta.pieceCount = header.pieceCount;
+    std::memcpy(meta.infoHash.data(), header.infoHashV1, 20);
+    std::memcpy(meta.infoHashV2.data(), header.infoHash, 32);
+
+    std::vector<FileRecord> files;
+    reader.read(files, header.fileCount);
+    meta.files.reserve(files.size());
+    meta.offsets.reserve(files.size() + 1);
+    for (const FileRecord& f : files) {
+      TorrentMetainfo::File& out = meta.files.emplace_back();
+      out.path = text(f.path);
+      out.length = f.length;
+      out.offset = f.offset;
+      out.pad = f.pad;
+      out.layer = f.layer;
+      std::memcpy(out.piecesRoot.data(), f.piecesRoot, 32);
+      meta.offsets.push_back(f.offset);
+    }
+    meta.offsets.push_back(meta.totalLength);
+    meta.layers = reader.view<MerkleTree::Hash>(header.layerCount);
+    std::vector<UrlRecord> urls;
+    reader.read(urls, header.urlCount);
+    for (const UrlRecord& url : urls) {
+      if (meta.announceList.size() <= url.tier)
+        meta.announceList.resize(url.tier + 1);
+      meta.announceList[url.tier].push_back(text(url.url));
+    }
+    meta.hashes = reader.view<TorrentMetainfo::PieceHash>(header.hashCount);
+    meta.storage = file;
+    meta.pending = std::make_shared<TorrentMetainfo::PendingCheck>();
+    meta.pending->check = [layers = meta.layers, hashes = meta.hashes,
+                           expected = header.arraysChecksum] {
+      return arraysChecksum(layers, hashes) == expected;
+    };
+    return meta;
+  }
+
+  // Raw record of an entry, for carrying it over into a new cache
+  std::string_view record(size_t entry) const {
+    return file->view().substr(index[entry].offset, index[entry].length);
+  }
+
+  // Serialize one torrent into a record
+  static std::string makeRecord(const TorrentMetainfo& meta,
+                                const Source& source) {
+    std::string strings;
+    auto intern = [&strings](std::string_view text) {
+      StringRef ref{static_cast<uint32_t>(strings.size()),
+                    static_cast<uint32_t>(text.size())};
+      strings += text;
+      return ref;
+    };
+
+    RecordHeader header{};
+    header.totalLength = meta.totalLength;
+    header.pieceCount = meta.pieceCount;
+    header.creationDate = meta.creationDate;
+    header.sourceSize = source.size;
+    header.sourceMtime = source.mtime;
+    header.arraysChecksum = arraysChecksum(meta.layers, meta.hashes);
+    header.pieceLength = meta.pieceLength;
+    header.flags = (meta.v1 ? flagV1 : 0) | (meta.v2 ? flagV2 : 0) |
+                   (meta.multiFile ? flagMultiFile : 0);
+    header.hashCount = static_cast<uint32_t>(meta.hashes.size());
+    header.fileCount = static_cast<uint32_t>(meta.files.size());
+    header.layerCount = static_cast<uint32_t>(meta.layers.size());
+    std::memcpy(header.infoHashV1, meta.infoHash.data(), 20);
+    std::memcpy(header.infoHash, meta.infoHashV2.data(), 32);
+    header.source = intern(source.path);
+    header.name = intern(meta.name);
+    header.announce = intern(meta.announce);
+    header.comment = intern(meta.comment);
+
+    std::vector<FileRecord> files;
+    files.reserve(meta.files.size());
+    for (const TorrentMetainfo::File& f : meta.files) {
+      FileRecord& out = files.emplace_back();
+      out.length = f.length;
+      out.offset = f.offset;
+      out.layer = f.layer;
+      std::memcpy(out.piecesRoot, f.piecesRoot.data(), 32);
+      out.path = intern(f.path);
+      out.pad = f.pad;
+    }
+    std::vector<UrlRecord> urls;
+    for (size_t tier = 0; tier < meta.announceList.size(); tier++) {
+      for (const std::string& url : meta.announceList[tier]) {
+        urls.push_back({static_cast<uint32_t>(tier), intern(url)});
+      }
+    }
+    header.urlCount = static_cast<uint32_t>(urls.size());
+    if (strings.size() > UINT32_MAX)
+      throw std::length_error("Metainfo too large to cache");
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    std::string out;
+    out.reserve(sizeof(header) + files.size() * sizeof(FileRecord) +
+                meta.layers.size() * 32 + urls.size() * sizeof(UrlRecord) +
+                meta.hashes.size() * 20 + strings.size());
+    append(out, &header, 1);
+    append(out, files.data(), files.size());
+    append(out, meta.layers.data(), meta.layers.size());
+    append(out, urls.data(), urls.size());
+    append(out, meta.hashes.data(), meta.hashes.size());
+    out += strings;
+    return out;
+  }
+
+  // Write a cache holding `records` to `path`, replacing any existing file
+  // atomically
+  static void write(const std::string& path,
+                    const std::vector<std::string_view>& records) {
+    std::vector<IndexEntry> entries(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+      RecordHeader header;
+      if (records[i].size() < sizeof(header))
+        throw std::invalid_argument("Invalid metainfo cache record");
+      std::memcpy(&header, records[i].data(), sizeof(header));
+      IndexEntry& entry = entries[i];
+      std::memcpy(entry.infoHash, header.infoHash, 32);
+      entry.sourceSize = header.sourceSize;
+      entry.sourceMtime = header.sourceMtime;
+      entry.length = records[i].size();
+      std::optional<uint64_t> checksum = recordChecksum(records[i]);
+      if (!checksum)
+        throw std::invalid_argument("Invalid metainfo cache record");
+      entry.checksum = *checksum;
+    }
+
+    // Records go in info-hash order, and the path index points into it
+    std::vector<size_t> order(records.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&entries](size_t a, size_t b) {
+      return std::memcmp(entries[a].infoHash, entries[b].infoHash, 32) < 0;
+    });
+    std::vector<IndexEntry> sorted(entries.size());
+    std::vector<PathEntry> byPath(records.size());
+    uint64_t offset = sizeof(Header) +
+                      records.size() * (sizeof(IndexEntry) + sizeof(PathEntry));
+    for (size_t i = 0; i < order.size(); i++) {
+      sorted[i] = entries[order[i]];
+      sorted[i].offset = offset;
+      offset += (sorted[i].length + 7) / 8 * 8;
+      byPath[i] = {fnv1a(sourcePath(records[order[i]])), i};
+    }
+    std::sort(byPath.begin(), byPath.end(),
+              [](const PathEntry& a, const PathEntry& b) {
+                return a.pathHash < b.pathHash;
+              });
+
+    std::string index;
+    append(index, sorted.data(), sorted.size());
+    append(index, byPath.data(), byPath.size());
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = formatVersion;
+    header.count = static_cast<uint32_t>(records.size());
+    header.checksum = fnv1a(index);
+    header.fileSize = offset;
+
+    std::string temp = path + ".tmp";
+    {
+      std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(index.data(), index.size());
+      for (size_t i : order) {
+        static const char zeros[8] = {};
+        out.write(records[i].data(), records[i].size());
+        out.write(zeros, (8 - records[i].size() % 8) % 8);
+      }
+      if (!out.flush())
+        throw std::runtime_error("Cannot write metainfo cache " + temp);
+    }
+    std::filesystem::rename(temp, path);
+  }
+
+ private:
+  static constexpr char magic[8] = {'B', 'T', 'M', 'E', 'T', 'A', 'C', 0};
+  static constexpr uint32_t flagV1 = 1, flagV2 = 2, flagMultiFile = 4;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t checksum;  // Of both indexes
+    uint64_t fileSize;
+  };
+
+  struct IndexEntry {
+    uint8_t infoHash[32];
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t offset;  // Of the record, from the start of the file
+    uint64_t length;
+    uint64_t checksum;  // Of the record, see recordChecksum
+  };
+
+  struct PathEntry {
+    uint64_t pathHash;
+    uint64_t entry;  // Position in the info-hash index
+  };
+
+  struct StringRef {
+    uint32_t offset;  // Into the record's string pool
+    uint32_t length;
+  };
+
+  struct RecordHeader {
+    uint64_t totalLength;
+    uint64_t pieceCount;
+    int64_t creationDate;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t arraysChecksum;  // Of the piece layers, then the piece hashes
+    uint32_t pieceLength;
+    uint32_t flags;
+    uint32_t hashCount;
+    uint32_t fileCount;
+    uint32_t layerCount;
+    uint32_t urlCount;
+    uint32_t stringBytes;
+    uint8_t infoHashV1[20];
+    uint8_t infoHash[32];
+    StringRef source, name, announce, comment;
+  };
+
+  struct FileRecord {
+    uint64_t length;
+    uint64_t offset;
+    uint64_t layer;
+    uint8_t piecesRoot[32];
+    StringRef path;
+    uint32_t pad;
+    uint32_t reserved;
+  };
+
+  struct UrlRecord {
+    uint32_t tier;
+    StringRef url;
+  };
+
+  // No implicit padding anywhere, so every byte written is initialized
+  static_assert(sizeof(Header) == 32 && sizeof(IndexEntry) == 72 &&
+                    sizeof(PathEntry) == 16 && sizeof(RecordHeader) == 160 &&
+                    sizeof(FileRecord) == 72 && sizeof(UrlRecord) == 12,
+                "Metainfo cache layout must be fixed");
+
+  // Sequential reads out of a record, bounds-checked against corruption
+  struct Reader {
+    std::string_view data;
+    size_t pos;
+
+    template <typename T>
+    void read(std::vector<T>& out, size_t n) {
+      const char* items = take(n, sizeof(T));
+      out.resize(n);
+      if (n == 0) return;
+      std::memcpy(static_cast<void*>(out.data()), items, n * sizeof(T));
+    }
+
+    // In place, for byte arrays that need no alignment
+    template <typename T>
+    std::span<const T> view(size_t n) {
+      static_assert(alignof(T) == 1);
+      return {reinterpret_cast<const T*>(take(n, sizeof(T))), n};
+    }
+
+    // Skip over `n` items of `size` bytes, returning where they start
+    const char* take(size_t n, size_t size) {
+      if (n > (data.size() - pos) / size)
+        throw std::runtime_error("Corrupt metainfo cache record");
+      const char* start = data.data() + pos;
+      pos += n * size;
+      return start;
+    }
+  };
+
+  template <typename T>
+  static void append(std::string& out, const T* items, size_t n) {
+    out.append(reinterpret_cast<const char*>(items), n * sizeof(T));
+  }
+
+  // Continue from `hash` to checksum several pieces as one
+  static uint64_t fnv1a(std::string_view bytes,
+                        uint64_t hash = 0xcbf29ce484222325) {
+    for (unsigned char c : bytes) {
+      hash ^= c;
+      hash *= 0x100000001b3;
+    }
+    return hash;
+  }
+
+  template <typename T>
+  static std::string_view bytes(std::span<const T> items) {
+    return {reinterpret_cast<const char*>(items.data()), items.size_bytes()};
+  }
+
+  static uint64_t arraysChecksum(
+      std::span<const MerkleTree::Hash> layers,
+      std::span<const TorrentMetainfo::PieceHash> hashes) {
+    return fnv1a(bytes(hashes), fnv1a(bytes(layers)));
+  }
+
+  // Checksum of a record without its piece layers and hashes, which are
+  // large and covered by RecordHeader::arraysChecksum instead. std::nullopt
+  // if the counts in its header do not fit the record.
+  static std::optional<uint64_t> recordChecksum(std::string_view record) {
+    RecordHeader header;
+    std::memcpy(&header, record.data(), sizeof(header));
+    uint64_t layers =
+        sizeof(header) + uint64_t{header.fileCount} * sizeof(FileRecord);
+    uint64_t urls = layers + uint64_t{header.layerCount} * 32;
+    uint64_t hashes = urls + uint64_t{header.urlCount} * sizeof(UrlRecord);
+    uint64_t strings = hashes + uint64_t{header.hashCount} * 20;
+    if (strings > record.size()) return std::nullopt;
+    uint64_t hash = fnv1a(record.substr(0, layers));
+    hash = fnv1a(record.substr(urls, hashes - urls), hash);
+    return fnv1a(record.substr(strings), hash);
+  }
+
+  // Checksum a record on first use only; threads racing on one entry at
+  // worst both compute the same answer
+  bool intact(size_t entry) const {
+    uint8_t state = checked[entry].load(std::memory_order_relaxed);
+    if (state == unchecked) {
+      std::optional<uint64_t> checksum = recordChecksum(record(entry));
+      state = checksum == index[entry].checksum ? good : damaged;
+      checked[entry].store(state, std::memory_order_relaxed);
+    }
+    return state == good;
+  }
+
+  std::string_view sourcePath(size_t entry) const {
+    return sourcePath(record(entry));
+  }
+
+  static std::string_view sourcePath(std::string_view record) {
+    RecordHeader header;
+    std::memcpy(&header, record.data(), sizeof(header));
+    std::string_view strings = record.substr(
+        record.size() - std::min<size_t>(header.stringBytes, record.size()));
+    return strings.substr(std::min<size_t>(header.source.offset,
+                                           strings.size()),
+                          header.source.length);
+  }
+
+  static constexpr uint8_t unchecked = 0, good = 1, damaged = 2;
+
+  // Shared with every TorrentMetainfo loaded from it
+  std::shared_ptr<const MappedFile> file;
+  std::unique_ptr<std::atomic<uint8_t>[]> checked;  // Per entry
+  const IndexEntry* index = nullptr;
+  const PathEntry* paths = nullptr;
+  size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef PIECE_ASSEMBLER_HPP
+#define PIECE_ASSEMBLER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "MerkleTree.hpp"
+#include "TorrentMetainfo.hpp"
+#include "sha1.h"
+
+// Hashes pieces while their 16 KiB blocks arrive, so the verdict is ready
+// with the last block and nothing has to be read back from disk. v2 leaves
+// are hashed from each block on arrival, in any order. The v1 SHA-1 runs
+// over the contiguous prefix received so far; a block that arrives ahead
+// of a gap is copied and held until the gap fills, and is the only data
+// ever buffered. Not thread-safe: use one assembler per download thread or
+// guard it.
+class PieceAssembler {
+ public:
+  enum class Status { Incomplete, Valid, Invalid };
+
+  explicit PieceAssembler(const TorrentMetainfo& metainfo)
+      : metainfo(metainfo) {}
+
+  // Take block `data` at `offset` into piece `piece`. Blocks start on a
+  // 16 KiB boundary and are 16 KiB long except at the end of the piece;
+  // anything else throws std::invalid_argument. The last missing block
+  // returns the piece's verdict and forgets it, so an invalid piece can
+  // be downloaded again. Repeated blocks are ignored.
+  Status addBlock(size_t piece, uint32_t offset, std::string_view data) {
+    uint32_t size = metainfo.getPieceSize(piece);
+    if (offset % MerkleTree::blockSize != 0 || offset >= size ||
+        data.size() !=
+            std::min<size_t>(MerkleTree::blockSize, size - offset))
+      throw std::invalid_argument("Block does not match the piece layout");
+
+    auto it = pieces.find(piece);
+    if (it == pieces.end()) it = pieces.emplace(piece, start(piece)).first;
+    Assembly& assembly = it->second;
+    size_t block = offset / MerkleTree::blockSize;
+    if (assembly.have[block]) return Status::Incomplete;
+    assembly.have[block] = 1;
+    assembly.received++;
+
+    if (assembly.merkle && block < assembly.merkle->blocks) {
+      size_t end = std::min<size_t>(assembly.fileBytes - offset, data.size());
+      assembly.leaves[block] = MerkleTree::hashBlock(data.substr(0, end));
+    }
+    if (metainfo.hasV1()) {
+      if (block == assembly.next) {
+        assembly.sha1.update(data);
+        assembly.next++;
+        // Drain the blocks this one connected
+        for (auto w = assembly.waiting.begin();
+             w != assembly.waiting.end() && w->first == assembly.next;
+             w = assembly.waiting.erase(w)) {
+          assembly.sha1.update(w->second);
+          buffered -= w->second.size();
+          assembly.next++;
+        }
+      } else {
+        assembly.waiting.emplace(block, std::string(data));
+        buffered += data.size();
+      }
+    }
+    if (assembly.received < assembly.have.size()) return Status::Incomplete;
+
+    bool valid = finish(piece, assembly);
+    pieces.erase(it);
+    return valid ? Status::Valid : Status::Invalid;
+  }
+
+  // Drop what has been received of `piece`, e.g. when its peer goes away
+  void abandon(size_t piece) {
+    auto it = pieces.find(piece);
+    if (it == pieces.end()) return;
+    for (const auto& [block, data] : it->second.waiting) {
+      buffered -= data.size();
+    }
+    pieces.erase(it);
+  }
+
+  // Pieces with some but not all blocks received
+  size_t activePieces() const { return pieces.size(); }
+  // Bytes of out-of-order blocks held back from the SHA-1
+  size_t bufferedBytes() const { return buffered; }
+
+ private:
+  struct Assembly {
+    std::vector<uint8_t> have;  // Per block
+    size_t received = 0;
+    // v1: SHA-1 of blocks [0, next), and blocks past the gap
+    SHA1 sha1;
+    size_t next = 0;
+    std::map<size_t, std::string> waiting;
+    // v2: expected subtree, leaves so far, and how much of the piece
+    // belongs to the file rather than the padding after it
+    std::optional<TorrentMetainfo::MerklePiece> merkle;
+    std::vector<MerkleTree::Hash> leaves;
+    uint64_t fileBytes = 0;
+  };
+
+  Assembly start(size_t piece) const {
+    Assembly assembly;
+    uint32_t size = metainfo.getPieceSize(piece);
+    assembly.have.resize((size + MerkleTree::blockSize - 1) /
+                         MerkleTree::blockSize);
+    assembly.merkle = metainfo.getMerklePiece(piece);
+    if (assembly.merkle) {
+      uint64_t begin = uint64_t{piece} * metainfo.getPieceLength();
+      const auto& file = metainfo.getFiles()[metainfo.fileAt(begin)];
+      assembly.fileBytes = file.offset + file.length - begin;
+      assembly.leaves.resize(assembly.merkle->blocks);
+    }
+    return assembly;
+  }
+
+  bool finish(size_t piece, Assembly& assembly) const {
+    if (metainfo.hasV1() &&
+        assembly.sha1.digest() != metainfo.getPieceHash(piece))
+      return false;
+    if (assembly.merkle &&
+        MerkleTree::subtreeRoot(assembly.leaves.data(), assembly.leaves.size(),
+                                assembly.merkle->width) !=
+            assembly.merkle->root)
+      return false;
+    return true;
+  }
+
+  const TorrentMetainfo& metainfo;
+  std::unordered_map<size_t, Assembly> pieces;
+  size_t buffered = 0;
+};
+
+#endif
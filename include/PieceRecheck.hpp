@@ -0,0 +1,332 @@
+#ifndef PIECE_RECHECK_HPP
+#define PIECE_RECHECK_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Bitfield.hpp"
+#include "ThreadPool.hpp"
+#include "TorrentMetainfo.hpp"
+
+// Checks which pieces of a torrent are already on disk. Dedicated reader
+// threads claim spans of whole pieces in order and fill page-aligned
+// buffers with large positional reads; each filled span goes to the pool,
+// whose workers verify its pieces against the v1 and v2 hashes and hand
+// the buffer back. Readers wait for a free buffer, so memory in flight
+// never exceeds the limit however big the torrent is. Missing or short
+// files simply fail the pieces they cover.
+class PieceRecheck {
+ public:
+  struct Progress {
+    size_t piecesChecked = 0;
+    size_t piecesValid = 0;
+    size_t pieceCount = 0;
+    uint64_t bytesChecked = 0;
+    uint64_t totalBytes = 0;
+    double seconds = 0;
+
+    double bytesPerSecond() const {
+      return seconds > 0 ? bytesChecked / seconds : 0;
+    }
+  };
+
+  using ProgressHandler = std::function<void(const Progress&)>;
+
+  PieceRecheck(const TorrentMetainfo& metainfo, ThreadPool& pool)
+      : metainfo(metainfo), pool(pool) {}
+
+  // Threads issuing reads; more than one keeps several requests queued on
+  // SSDs, which need that to reach full bandwidth
+  void setIoThreads(size_t threads) {
+    ioThreads = std::max<size_t>(threads, 1);
+  }
+  // Bytes per read, rounded down to whole pieces but at least one piece
+  void setReadSize(size_t bytes) { readSize = bytes; }
+  // Upper bound on buffer memory; one span is always allowed
+  void setMemoryLimit(size_t bytes) { memoryLimit = bytes; }
+  // Called on the thread running check() about every `interval`, and once
+  // at the end
+  void onProgress(ProgressHandler handler,
+                  std::chrono::milliseconds interval =
+                      std::chrono::milliseconds(100)) {
+    progressHandler = std::move(handler);
+    progressInterval = interval;
+  }
+
+  // Verify every piece against the files under `directory`, where the
+  // torrent's paths (its name first) are resolved. Set bits are pieces
+  // that matched.
+  Bitfield check(const std::filesystem::path& directory) {
+    Run run;
+    size_t count = metainfo.getPieceCount();
+    uint32_t length = metainfo.getPieceLength();
+    run.piecesPerSpan = std::max<size_t>(readSize / length, 1);
+    run.spans = (count + run.piecesPerSpan - 1) / run.piecesPerSpan;
+    run.valid.assign(count, 0);
+    // Enough buffers for every worker to hash while every reader reads,
+    // within the limit
+    size_t spanBytes = run.piecesPerSpan * length;
+    size_t buffers = std::min(memoryLimit / spanBytes,
+                              pool.size() + 2 * ioThreads);
+    buffers = std::clamp<size_t>(buffers, 1, std::max<size_t>(run.spans, 1));
+    for (size_t i = 0; i < buffers; i++) {
+      run.buffers.emplace_back(static_cast<char*>(
+          ::operator new(spanBytes, std::align_val_t{alignment})));
+      run.free.push_back(i);
+    }
+
+    Progress progress;
+    progress.pieceCount = count;
+    progress.totalBytes = metainfo.getTotalLength();
+    auto start = std::chrono::steady_clock::now();
+    auto report = [&] {
+      if (!progressHandler) return;
+      progress.piecesChecked = run.checked.load();
+      progress.piecesValid = run.passed.load();
+      progress.bytesChecked = run.bytes.load();
+      progress.seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+      progressHandler(progress);
+    };
+
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < ioThreads; i++) {
+      try {
+        readers.emplace_back([this, &run, &directory] {
+          readSpans(run, directory);
+        });
+      } catch (...) {
+        run.fail(std::current_exception());
+        break;
+      }
+    }
+    {
+      // Tasks still refer to the buffers, so wait for them even on failure
+      std::unique_lock<std::mutex> lock(run.mutex);
+      auto next = std::chrono::steady_clock::now() + progressInterval;
+      while (run.readersDone < readers.size() || run.inFlight > 0) {
+        if (run.changed.wait_until(lock, next) == std::cv_status::timeout) {
+          lock.unlock();
+          report();
+          lock.lock();
+          next = std::chrono::steady_clock::now() + progressInterval;
+        }
+      }
+    }
+    for (auto& reader : readers) reader.join();
+    if (run.error) std::rethrow_exception(run.error);
+    report();
+
+    Bitfield result(count);
+    for (size_t piece = 0; piece < count; piece++) {
+      if (run.valid[piece]) result.set(piece);
+    }
+    return result;
+  }
+
+ private:
+  static constexpr size_t alignment = 4096;
+
+  struct AlignedDelete {
+    void operator()(char* p) const {
+      ::operator delete(p, std::align_val_t{alignment});
+    }
+  };
+  using Buffer = std::unique_ptr<char, AlignedDelete>;
+
+  // State shared by the readers, the hashing tasks and check()
+  struct Run {
+    size_t piecesPerSpan = 1;
+    size_t spans = 0;
+    std::vector<Buffer> buffers;
+    // One byte per piece, so tasks never write to the same byte
+    std::vector<uint8_t> valid;
+    std::atomic<size_t> nextSpan{0}, checked{0}, passed{0};
+    std::atomic<uint64_t> bytes{0};
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<size_t> free;
+    size_t inFlight = 0;
+    size_t readersDone = 0;
+    std::exception_ptr error;
+
+    void fail(std::exception_ptr e) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) error = e;
+      changed.notify_all();
+    }
+  };
+
+  // Positional reads, keeping the last file opened
+  class Reader {
+   public:
+    explicit Reader(const std::filesystem::path& directory)
+        : directory(directory) {}
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader() {
+      if (fd != -1) ::close(fd);
+    }
+
+    // Read up to `size` bytes at `offset` of file `index`; returns how
+    // many were there
+    size_t read(size_t index, const std::string& path, uint64_t offset,
+                char* out, size_t size) {
+      if (index != current) {
+        if (fd != -1) ::close(fd);
+        fd = ::open((directory / path).c_str(), O_RDONLY | O_CLOEXEC);
+#ifdef POSIX_FADV_SEQUENTIAL
+        if (fd != -1) ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        current = index;
+      }
+      if (fd == -1) return 0;
+      size_t done = 0;
+      while (done < size) {
+        ssize_t n = ::pread(fd, out + done, size - done,
+                            static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+      }
+      return done;
+    }
+
+   private:
+    std::filesystem::path directory;
+    size_t current = SIZE_MAX;
+    int fd = -1;
+  };
+
+  void readSpans(Run& run, const std::filesystem::path& directory) {
+    try {
+      Reader reader(directory);
+      while (true) {
+        size_t span = run.nextSpan++;
+        if (span >= run.spans) break;
+        size_t buffer;
+        {
+          std::unique_lock<std::mutex> lock(run.mutex);
+          run.changed.wait(lock,
+                           [&run] { return run.error || !run.free.empty(); });
+          if (run.error) break;
+          buffer = run.free.back();
+          run.free.pop_back();
+        }
+        std::vector<uint8_t> missing =
+            readSpan(reader, run, span, run.buffers[buffer].get());
+        {
+          std::lock_guard<std::mutex> lock(run.mutex);
+          run.inFlight++;
+        }
+        try {
+          pool.submit([this, &run, span, buffer,
+                       missing = std::move(missing)] {
+            hashSpan(run, span, buffer, missing);
+          });
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(run.mutex);
+          run.inFlight--;
+          throw;
+        }
+      }
+    } catch (...) {
+      run.fail(std::current_exception());
+    }
+    // Notified under the lock: once check() sees the count, `run` may go
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.readersDone++;
+    run.changed.notify_all();
+  }
+
+  // Fill `out` with the pieces of `span`; pad files read as zeros. The
+  // result flags the pieces some of whose bytes could not be read.
+  std::vector<uint8_t> readSpan(Reader& reader, const Run& run, size_t span,
+                                char* out) const {
+    const auto& files = metainfo.getFiles();
+    uint32_t length = metainfo.getPieceLength();
+    size_t first = span * run.piecesPerSpan;
+    size_t last = std::min(first + run.piecesPerSpan, run.valid.size());
+    std::vector<uint8_t> missing(last - first);
+    uint64_t begin = uint64_t{first} * length;
+    uint64_t end = std::min(uint64_t{last} * length, metainfo.getTotalLength());
+    for (uint64_t at = begin; at < end;) {
+      size_t index = metainfo.fileAt(at);
+      const TorrentMetainfo::File& file = files[index];
+      uint64_t within = at - file.offset;
+      size_t take =
+          static_cast<size_t>(std::min(end - at, file.length - within));
+      char* data = out + (at - begin);
+      size_t got = take;
+      if (file.pad) {
+        std::memset(data, 0, take);
+      } else {
+        got = reader.read(index, file.path, within, data, take);
+      }
+      if (got < take) {
+        uint64_t final = (at + take - 1) / length;
+        for (uint64_t piece = (at + got) / length; piece <= final; piece++) {
+          missing[piece - first] = 1;
+        }
+      }
+      at += take;
+    }
+    return missing;
+  }
+
+  void hashSpan(Run& run, size_t span, size_t buffer,
+                const std::vector<uint8_t>& missing) {
+    try {
+      uint32_t length = metainfo.getPieceLength();
+      size_t first = span * run.piecesPerSpan;
+      const char* data = run.buffers[buffer].get();
+      for (size_t i = 0; i < missing.size(); i++) {
+        size_t piece = first + i;
+        uint32_t size = metainfo.getPieceSize(piece);
+        bool ok = !missing[i] &&
+                  metainfo.verifyPiece(
+                      piece, std::string_view(data + size_t{i} * length, size));
+        run.valid[piece] = ok;
+        if (ok) run.passed++;
+        run.checked++;
+        run.bytes += size;
+      }
+    } catch (...) {
+      run.fail(std::current_exception());
+    }
+    std::lock_guard<std::mutex> lock(run.mutex);
+    run.free.push_back(buffer);
+    run.inFlight--;
+    run.changed.notify_all();
+  }
+
+  const TorrentMetainfo& metainfo;
+  ThreadPool& pool;
+  size_t ioThreads = 2;
+  size_t readSize = 4 << 20;
+  size_t memoryLimit = 256 << 20;
+  ProgressHandler progressHandler;
+  std::chrono::milliseconds progressInterval{100};
+};
+
+#endif
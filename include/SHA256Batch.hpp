@@ -0,0 +1,232 @@
+#ifndef SHA256_BATCH_HPP
+#define SHA256_BATCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "sha256.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_BATCH_X86 1
+#endif
+
+// Multi-buffer SHA-256: independent messages are hashed side by side, one
+// per 32-bit vector lane, so a single pass through the rounds advances 8
+// hashes with AVX2, 4 with SSE2 or 1 on the scalar fallback. All lanes of
+// a group step through their blocks together, which suits batches of
+// similar-sized messages: Merkle leaves, pairs of child hashes, node IDs.
+// Shorter messages in a group simply stop updating once they are done.
+// CPUs with the SHA extensions hash one message at a time faster still, so
+// there the batch is handed to SHA256's SHA-NI path instead.
+class SHA256Batch {
+ public:
+  using Digest = std::array<uint8_t, 32>;
+
+  enum class Kernel { Auto, Scalar, SSE2, AVX2, SHANI };
+
+  // out[i] = SHA-256(messages[i]) for i < count
+  static void hash(const std::string_view* messages, size_t count,
+                   Digest* out, Kernel kernel = Kernel::Auto) {
+    if (kernel == Kernel::Auto) kernel = bestKernel();
+    size_t width = lanes(kernel);
+    for (size_t i = 0; i < count; i += width) {
+      size_t n = std::min(width, count - i);
+      switch (kernel) {
+#ifdef SHA256_BATCH_X86
+        case Kernel::SHANI:
+          for (size_t j = i; j < i + n; j++) {
+            SHA256 sha;
+            sha.update(messages[j]);
+            out[j] = sha.digest();
+          }
+          break;
+        case Kernel::AVX2:
+          hashAVX2(messages + i, n, out + i);
+          break;
+        case Kernel::SSE2:
+          hashSSE2(messages + i, n, out + i);
+          break;
+#endif
+        default:
+          hashScalar(messages + i, n, out + i);
+          break;
+      }
+    }
+  }
+
+  // Messages hashed per pass
+  static size_t lanes(Kernel kernel) {
+    if (kernel == Kernel::Auto) kernel = bestKernel();
+#ifdef SHA256_BATCH_X86
+    if (kernel == Kernel::AVX2) return 8;
+    if (kernel == Kernel::SSE2) return 4;
+#endif
+    return 1;
+  }
+
+  static Kernel bestKernel() {
+#ifdef SHA256_BATCH_X86
+    static const Kernel best = SHA256::hardwareAccelerated() ? Kernel::SHANI
+                               : __builtin_cpu_supports("avx2") ? Kernel::AVX2
+                               : __builtin_cpu_supports("sse2") ? Kernel::SSE2
+                                                                : Kernel::Scalar;
+    return best;
+#else
+    return Kernel::Scalar;
+#endif
+  }
+
+ private:
+  // GCC vector extensions: operators apply lane by lane
+  using Vec1 = uint32_t __attribute__((vector_size(4)));
+  using Vec4 = uint32_t __attribute__((vector_size(16)));
+  using Vec8 = uint32_t __attribute__((vector_size(32)));
+
+  static constexpr uint32_t K[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+      0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+      0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+      0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+      0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+      0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+      0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+  static constexpr uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                          0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                          0x1f83d9ab, 0x5be0cd19};
+
+  // A message's last one or two blocks: the tail bytes, 0x80, zeros and
+  // the bit length
+  struct Tail {
+    uint8_t bytes[128];
+    size_t blocks;
+  };
+
+  static void makeTail(std::string_view message, Tail& tail) {
+    size_t rest = message.size() % 64;
+    tail.blocks = rest < 56 ? 1 : 2;
+    std::memset(tail.bytes, 0, sizeof(tail.bytes));
+    // An empty message may have a null data(), invalid even for memcpy of 0
+    if (rest)
+      std::memcpy(tail.bytes, message.data() + message.size() - rest, rest);
+    tail.bytes[rest] = 0x80;
+    uint64_t bits = uint64_t{message.size()} * 8;
+    uint8_t* end = tail.bytes + tail.blocks * 64;
+    for (int i = 1; i <= 8; i++, bits >>= 8) end[-i] = uint8_t(bits);
+  }
+
+// A macro rather than a function: a helper returning a 256-bit vector
+// would be compiled for the default, non-AVX calling convention
+#define SHA256_BATCH_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+  // Hash up to one message per lane of V. Inlined into each kernel so the
+  // vector code is generated for that kernel's instruction set.
+  template <typename V>
+  __attribute__((always_inline)) static inline void hashLanes(
+      const std::string_view* messages, size_t count, Digest* out) {
+    constexpr size_t N = sizeof(V) / sizeof(uint32_t);
+    Tail tails[N];
+    size_t full[N], total[N], blocks = 0;
+    for (size_t l = 0; l < N; l++) {
+      full[l] = total[l] = 0;
+      if (l >= count) continue;
+      makeTail(messages[l], tails[l]);
+      full[l] = messages[l].size() / 64;
+      total[l] = full[l] + tails[l].blocks;
+      blocks = std::max(blocks, total[l]);
+    }
+
+    V state[8];
+    for (int i = 0; i < 8; i++) state[i] = V{} + initial[i];
+    for (size_t n = 0; n < blocks; n++) {
+      // Gather word t of every lane's block n into w[t]
+      V w[16], active{};
+      for (size_t l = 0; l < N; l++) {
+        const uint8_t* block = tails[0].bytes;
+        if (n < full[l]) {
+          block = reinterpret_cast<const uint8_t*>(messages[l].data()) + 64 * n;
+        } else if (n < total[l]) {
+          block = tails[l].bytes + (n - full[l]) * 64;
+        }
+        active[l] = n < total[l] ? ~0u : 0;
+        for (int t = 0; t < 16; t++) {
+          uint32_t word;
+          std::memcpy(&word, block + t * 4, 4);
+          w[t][l] = __builtin_bswap32(word);
+        }
+      }
+
+      V a = state[0], b = state[1], c = state[2], d = state[3];
+      V e = state[4], f = state[5], g = state[6], h = state[7];
+#pragma GCC unroll 64
+      for (int t = 0; t < 64; t++) {
+        if (t >= 16) {
+          V s0 = w[(t - 15) & 15], s1 = w[(t - 2) & 15];
+          s0 = SHA256_BATCH_ROTR(s0, 7) ^ SHA256_BATCH_ROTR(s0, 18) ^
+               (s0 >> 3);
+          s1 = SHA256_BATCH_ROTR(s1, 17) ^ SHA256_BATCH_ROTR(s1, 19) ^
+               (s1 >> 10);
+          w[t & 15] += s0 + w[(t - 7) & 15] + s1;
+        }
+        V sum1 = SHA256_BATCH_ROTR(e, 6) ^ SHA256_BATCH_ROTR(e, 11) ^
+                 SHA256_BATCH_ROTR(e, 25);
+        V sum0 = SHA256_BATCH_ROTR(a, 2) ^ SHA256_BATCH_ROTR(a, 13) ^
+                 SHA256_BATCH_ROTR(a, 22);
+        V t1 = h + sum1 + ((e & f) ^ (~e & g)) + K[t] + w[t & 15];
+        V t2 = sum0 + ((a & (b | c)) | (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+      }
+      // Lanes whose message has ended keep their final state
+      state[0] += a & active;
+      state[1] += b & active;
+      state[2] += c & active;
+      state[3] += d & active;
+      state[4] += e & active;
+      state[5] += f & active;
+      state[6] += g & active;
+      state[7] += h & active;
+    }
+
+    for (size_t l = 0; l < count; l++) {
+      for (int i = 0; i < 8; i++) {
+        uint32_t word = __builtin_bswap32(state[i][l]);
+        std::memcpy(out[l].data() + i * 4, &word, 4);
+      }
+    }
+  }
+
+#undef SHA256_BATCH_ROTR
+
+  static void hashScalar(const std::string_view* messages, size_t count,
+                         Digest* out) {
+    hashLanes<Vec1>(messages, count, out);
+  }
+
+#ifdef SHA256_BATCH_X86
+  __attribute__((target("sse2"))) static void hashSSE2(
+      const std::string_view* messages, size_t count, Digest* out) {
+    hashLanes<Vec4>(messages, count, out);
+  }
+
+  __attribute__((target("avx2"))) static void hashAVX2(
+      const std::string_view* messages, size_t count, Digest* out) {
+    hashLanes<Vec8>(messages, count, out);
+  }
+#endif
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads consuming a shared task queue. Tasks must not
+// block on other tasks of the same pool.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; i++) {
+      workers.emplace_back([this] { work(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers) worker.join();
+  }
+
+  size_t size() const { return workers.size(); }
+
+  // Queue `task`; its result or exception is delivered through the future
+  template <typename F>
+  auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto packaged =
+        std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+    std::future<R> result = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace([packaged] { (*packaged)(); });
+    }
+    ready.notify_one();
+    return result;
+  }
+
+  // Run body(begin, end) over [0, count) in chunks of at least `grain`
+  // items spread across the pool, and wait for all of them. The first
+  // exception thrown by a chunk is rethrown here.
+  template <typename F>
+  void parallelFor(size_t count, size_t grain, F body) {
+    size_t chunks = count / std::max<size_t>(grain, 1);
+    chunks = std::clamp<size_t>(chunks, 1, size() * 4);
+    std::vector<std::future<void>> pending;
+    pending.reserve(chunks);
+    for (size_t c = 0; c < chunks; c++) {
+      size_t begin = count * c / chunks, end = count * (c + 1) / chunks;
+      pending.push_back(submit([&body, begin, end] { body(begin, end); }));
+    }
+    for (auto& p : pending) p.wait();
+    for (auto& p : pending) p.get();
+  }
+
+ private:
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable ready;
+  bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef TORRENT_CREATOR_HPP
+#define TORRENT_CREATOR_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MerkleTree.hpp"
+#include "ThreadPool.hpp"
+#include "TorrentParser.hpp"
+#include "sha1.h"
+
+// Builds a .torrent for a file or directory. The calling thread reads the
+// data sequentially in large chunks into a small ring of buffers while the
+// pool hashes the chunks already read, so reading and hashing overlap and
+// memory stays at (pool size + 2) buffers however big the data set is.
+// Torrents are BitTorrent v2: every 16 KiB block becomes a Merkle leaf,
+// and each file gets a pieces root and, when it spans several pieces, a
+// piece layer. By default they are hybrids that also carry v1 SHA-1 piece
+// hashes, with BEP 47 pad files starting every file on a piece boundary.
+class TorrentCreator {
+ public:
+  struct Progress {
+    uint64_t bytesHashed = 0;
+    uint64_t totalBytes = 0;
+    double seconds = 0;
+
+    double bytesPerSecond() const {
+      return seconds > 0 ? bytesHashed / seconds : 0;
+    }
+  };
+
+  using ProgressHandler = std::function<void(const Progress&)>;
+
+  explicit TorrentCreator(ThreadPool& pool) : pool(pool) {}
+
+  // 0 picks a power of two giving roughly 1000-2000 pieces
+  void setPieceLength(uint32_t length) { pieceLength = length; }
+  void setAnnounce(std::string url) { announce = std::move(url); }
+  void setComment(std::string text) { comment = std::move(text); }
+  // Client name stored as "created by"; empty leaves it out
+  void setCreatedBy(std::string client) { createdBy = std::move(client); }
+  // false leaves out the v1 piece hashes and file list
+  void setHybrid(bool enabled) { hybrid = enabled; }
+  // Size of each sequential read, rounded up to whole 16 KiB blocks
+  void setReadSize(size_t bytes) {
+    size_t blocks = (std::max<size_t>(bytes, 1) + MerkleTree::blockSize - 1) /
+                    MerkleTree::blockSize;
+    readSize = blocks * MerkleTree::blockSize;
+  }
+  void onProgress(ProgressHandler handler) {
+    progressHandler = std::move(handler);
+  }
+
+  // Hash everything under `path` and return the bencoded torrent
+  std::string create(const std::string& path) {
+    namespace fs = std::filesystem;
+    std::vector<Input> inputs;
+    fs::path root(path);
+    bool single = fs::is_regular_file(root);
+    if (single) {
+      inputs.push_back({root, {}, fs::file_size(root)});
+    } else {
+      for (const auto& entry : fs::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file()) continue;
+        inputs.push_back({entry.path(), entry.path().lexically_relative(root),
+                          entry.file_size()});
+      }
+      // Same order as the keys of the bencoded file tree
+      std::sort(inputs.begin(), inputs.end(),
+                [](const Input& a, const Input& b) {
+                  return a.relative < b.relative;
+                });
+      if (inputs.empty())
+        throw std::invalid_argument("No files to create a torrent from");
+    }
+
+    Progress progress;
+    for (const Input& input : inputs) progress.totalBytes += input.size;
+    uint32_t length = pieceLength ? pieceLength : pickPieceLength(progress);
+    if (length < MerkleTree::blockSize || (length & (length - 1)) != 0)
+      throw std::invalid_argument("Piece length must be a power of two of at "
+                                  "least 16 KiB");
+
+    // Every file starts a piece; pad files fill the gaps for v1
+    size_t pieceCount = 0;
+    Input* previous = nullptr;
+    for (Input& input : inputs) {
+      if (input.size == 0) continue;
+      if (previous && previous->size % length != 0)
+        previous->pad = length - previous->size % length;
+      input.firstPiece = pieceCount;
+      pieceCount += (input.size + length - 1) / length;
+      previous = &input;
+    }
+    std::vector<SHA1::Digest> pieces(hybrid ? pieceCount : 0);
+
+    hashFiles(inputs, length, pieces, progress);
+
+    // Assemble the metainfo; std::map keeps every dictionary sorted
+    using Dict = std::map<BencodeValue::KeyType, BencodeValue>;
+    Dict tree, layers;
+    size_t blocksPerPiece = length / MerkleTree::blockSize;
+    for (Input& input : inputs) {
+      Dict file{{"length", static_cast<int64_t>(input.size)}};
+      if (input.size > 0) {
+        MerkleTree merkle(std::move(input.leaves));
+        std::string piecesRoot = bytes(merkle.root());
+        file["pieces root"] = piecesRoot;
+        if (input.size > length) {
+          std::string layer;
+          for (const auto& hash : merkle.pieceLayer(blocksPerPiece)) {
+            layer += bytes(hash);
+          }
+          layers[piecesRoot] = layer;
+        }
+      }
+      Dict* dir = &tree;
+      std::string name = single ? nameOf(root) : "";
+      for (const auto& component : input.relative) {
+        if (!name.empty()) dir = &subdirectory(*dir, name);
+        name = component.string();
+      }
+      (*dir)[name] = Dict{{"", file}};
+    }
+
+    Dict info{{"file tree", tree},
+              {"meta version", int64_t{2}},
+              {"name", nameOf(root)},
+              {"piece length", static_cast<int64_t>(length)}};
+    if (hybrid) {
+      std::string concatenated;
+      concatenated.reserve(pieces.size() * sizeof(SHA1::Digest));
+      for (const auto& hash : pieces) {
+        concatenated.append(hash.begin(), hash.end());
+      }
+      info["pieces"] = concatenated;
+      if (single) {
+        info["length"] = static_cast<int64_t>(inputs[0].size);
+      } else {
+        info["files"] = fileList(inputs);
+      }
+    }
+    Dict torrent{{"info", info},
+                 {"creation date", static_cast<int64_t>(std::time(nullptr))},
+                 {"piece layers", layers}};
+    if (!announce.empty()) torrent["announce"] = announce;
+    if (!createdBy.empty()) torrent["created by"] = createdBy;
+    if (!comment.empty()) torrent["comment"] = comment;
+    return BencodeValue(torrent).toString();
+  }
+
+ private:
+  struct Input {
+    std::filesystem::path path;
+    std::filesystem::path relative;  // Empty for a single-file torrent
+    uint64_t size;
+    uint64_t pad = 0;  // Zeros after the file up to the next piece
+    size_t firstPiece = 0;
+    std::vector<MerkleTree::Hash> leaves{};
+  };
+
+  // A chunk being hashed, and the buffer it occupies
+  struct Pending {
+    std::future<void> done;
+    size_t buffer;
+  };
+
+  static std::string bytes(const MerkleTree::Hash& hash) {
+    return std::string(hash.begin(), hash.end());
+  }
+
+  // Last component, also for "dir/" and "."
+  static std::string nameOf(const std::filesystem::path& path) {
+    auto normal = std::filesystem::absolute(path).lexically_normal();
+    if (!normal.has_filename()) normal = normal.parent_path();
+    return normal.filename().string();
+  }
+
+  static std::map<BencodeValue::KeyType, BencodeValue>& subdirectory(
+      std::map<BencodeValue::KeyType, BencodeValue>& dir,
+      const std::string& name) {
+    using Dict = std::map<BencodeValue::KeyType, BencodeValue>;
+    auto& node = dir[name];
+    if (!std::holds_alternative<Dict>(node.value)) node.value = Dict{};
+    return std::get<Dict>(node.value);
+  }
+
+  // The v1 "files" list, with a pad file after each file that needs one
+  static std::vector<BencodeValue> fileList(const std::vector<Input>& inputs) {
+    using Dict = std::map<BencodeValue::KeyType, BencodeValue>;
+    std::vector<BencodeValue> list;
+    for (const Input& input : inputs) {
+      std::vector<BencodeValue> path;
+      for (const auto& component : input.relative) {
+        path.emplace_back(component.string());
+      }
+      list.emplace_back(Dict{{"length", static_cast<int64_t>(input.size)},
+                             {"path", path}});
+      if (input.pad == 0) continue;
+      std::string length = std::to_string(input.pad);
+      list.emplace_back(
+          Dict{{"attr", std::string("p")},
+               {"length", static_cast<int64_t>(input.pad)},
+               {"path", std::vector<BencodeValue>{std::string(".pad"),
+                                                  length}}});
+    }
+    return list;
+  }
+
+  static uint32_t pickPieceLength(const Progress& progress) {
+    uint32_t length = MerkleTree::blockSize;
+    while (progress.totalBytes / length > 2000 && length < (16u << 20)) {
+      length *= 2;
+    }
+    return length;
+  }
+
+  // v1 hashes of whole pieces; a short last piece is followed by `pad`
+  // zeros, as the pad file after it holds
+  static void hashPieces(const char* data, size_t size, uint32_t length,
+                         uint64_t pad, SHA1::Digest* pieces) {
+    static const uint8_t zeros[MerkleTree::blockSize] = {};
+    for (size_t at = 0; at < size; at += length) {
+      size_t piece = std::min<size_t>(size - at, length);
+      SHA1 sha;
+      sha.update(reinterpret_cast<const uint8_t*>(data + at), piece);
+      for (uint64_t left = piece < length ? pad : 0; left > 0;) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(left, sizeof(zeros)));
+        sha.update(zeros, n);
+        left -= n;
+      }
+      *pieces++ = sha.digest();
+    }
+  }
+
+  void hashFiles(std::vector<Input>& inputs, uint32_t length,
+                 std::vector<SHA1::Digest>& pieces, Progress& progress) {
+    // v1 pieces are hashed whole, so chunks then hold whole pieces
+    size_t chunkSize =
+        hybrid ? (readSize + length - 1) / length * length : readSize;
+    size_t bufferCount = pool.size() + 2;
+    std::vector<std::unique_ptr<char[]>> buffers;
+    for (size_t i = 0; i < bufferCount; i++) {
+      buffers.emplace_back(new char[chunkSize]);
+    }
+    std::vector<size_t> free(bufferCount);
+    for (size_t i = 0; i < bufferCount; i++) free[i] = i;
+    std::deque<Pending> pending;
+    std::atomic<uint64_t> hashed{0};
+    auto start = std::chrono::steady_clock::now();
+
+    auto report = [&] {
+      if (!progressHandler) return;
+      progress.bytesHashed = hashed.load();
+      progress.seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+      progressHandler(progress);
+    };
+    // Wait for the oldest chunk and take back its buffer
+    auto recycle = [&] {
+      Pending oldest = std::move(pending.front());
+      pending.pop_front();
+      oldest.done.get();
+      free.push_back(oldest.buffer);
+      report();
+    };
+
+    try {
+      for (Input& input : inputs) {
+        input.leaves.resize((input.size + MerkleTree::blockSize - 1) /
+                            MerkleTree::blockSize);
+        File file(input.path);
+        for (uint64_t offset = 0; offset < input.size; offset += chunkSize) {
+          if (free.empty()) recycle();
+          size_t buffer = free.back();
+          free.pop_back();
+          size_t size = static_cast<size_t>(
+              std::min<uint64_t>(chunkSize, input.size - offset));
+          file.read(buffers[buffer].get(), size, input.path);
+
+          const char* data = buffers[buffer].get();
+          MerkleTree::Hash* leaves =
+              input.leaves.data() + offset / MerkleTree::blockSize;
+          SHA1::Digest* digests =
+              hybrid ? pieces.data() + input.firstPiece + offset / length
+                     : nullptr;
+          uint64_t pad = input.pad;
+          auto task = pool.submit(
+              [data, size, leaves, length, pad, digests, &hashed] {
+                MerkleTree::hashBlocks(std::string_view(data, size), leaves);
+                if (digests) hashPieces(data, size, length, pad, digests);
+                hashed += size;
+              });
+          pending.push_back({std::move(task), buffer});
+        }
+      }
+      while (!pending.empty()) recycle();
+    } catch (...) {
+      // Tasks still refer to the buffers; let them finish first
+      for (Pending& p : pending) p.done.wait();
+      throw;
+    }
+    report();
+  }
+
+  // Sequential reader over one file
+  class File {
+   public:
+    explicit File(const std::filesystem::path& path)
+        : fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+      if (fd == -1)
+        throw std::runtime_error("Cannot open " + path.string() + ": " +
+                                 std::strerror(errno));
+#ifdef POSIX_FADV_SEQUENTIAL
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File() { ::close(fd); }
+
+    void read(char* out, size_t size, const std::filesystem::path& path) {
+      while (size > 0) {
+        ssize_t n = ::read(fd, out, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0)
+          throw std::runtime_error("Cannot read " + path.string() +
+                                   (n == 0 ? ": file shrank"
+                                           : ": " + std::string(std::strerror(
+                                                        errno))));
+        out += n;
+        size -= static_cast<size_t>(n);
+      }
+    }
+
+   private:
+    int fd;
+  };
+
+  ThreadPool& pool;
+  uint32_t pieceLength = 0;
+  size_t readSize = 4 << 20;
+  bool hybrid = true;
+  std::string announce, comment;
+  std::string createdBy = "SmolTorrent";
+  ProgressHandler progressHandler;
+};
+
+#endif
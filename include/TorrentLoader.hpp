@@ -0,0 +1,185 @@
+#ifndef TORRENT_LOADER_HPP
+#define TORRENT_LOADER_HPP
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "MetainfoCache.hpp"
+#include "ThreadPool.hpp"
+#include "TorrentMetainfo.hpp"
+
+struct LoadedTorrent {
+  std::string path;
+  TorrentMetainfo metainfo;
+};
+
+struct LoadError {
+  std::string path;
+  std::string message;
+};
+
+// Loads every .torrent file in a directory at startup. Files are mapped
+// and parsed in batches on a thread pool, and the results are handed back
+// on the calling thread in directory order, one batch at a time, so the
+// session can take ownership without locking. At most a few batches per
+// worker are in flight, which bounds memory for very large directories.
+//
+// With a metainfo cache, unchanged files are restored from it instead of
+// being decoded, and the cache is rewritten afterwards if anything was
+// added, changed or removed.
+class TorrentLoader {
+ public:
+  struct Progress {
+    size_t total = 0;   // .torrent files found
+    size_t loaded = 0;  // Parsed successfully so far
+    size_t cached = 0;  // Of those, restored from the metainfo cache
+    size_t failed = 0;
+  };
+
+  using BatchHandler = std::function<void(std::vector<LoadedTorrent>&&)>;
+  using ErrorHandler = std::function<void(const LoadError&)>;
+  using ProgressHandler = std::function<void(const Progress&)>;
+
+  explicit TorrentLoader(ThreadPool& pool, size_t batchSize = 64)
+      : pool(pool), batchSize(std::max<size_t>(batchSize, 1)) {}
+
+  void onBatch(BatchHandler handler) { batchHandler = std::move(handler); }
+  void onError(ErrorHandler handler) { errorHandler = std::move(handler); }
+  void onProgress(ProgressHandler handler) {
+    progressHandler = std::move(handler);
+  }
+
+  // Keep parsed metainfo in a cache file at `path` across restarts. A
+  // cache that cannot be written is reported to the error handler.
+  void useCache(const std::string& path) { cachePath = path; }
+
+  // Load the directory and return the final counts. Throws
+  // std::filesystem::filesystem_error if it cannot be listed; problems
+  // with individual files go to the error handler instead.
+  Progress load(const std::string& directory) {
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".torrent")
+        paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::optional<MetainfoCache> opened;
+    if (!cachePath.empty()) opened.emplace(cachePath);
+    cache = opened ? &*opened : nullptr;
+    std::vector<std::string> records;  // Newly parsed torrents
+    std::vector<size_t> reused;        // Cache entries still current
+
+    Progress progress;
+    progress.total = paths.size();
+    std::deque<std::future<Batch>> pending;
+    size_t next = 0;
+    try {
+      while (next < paths.size() || !pending.empty()) {
+        while (next < paths.size() && pending.size() < pool.size() * 2) {
+          size_t end = std::min(next + batchSize, paths.size());
+          pending.push_back(pool.submit([this, &paths, next, end] {
+            return loadBatch(paths, next, end);
+          }));
+          next = end;
+        }
+        Batch batch = pending.front().get();
+        pending.pop_front();
+
+        progress.loaded += batch.torrents.size();
+        progress.cached += batch.reused.size();
+        progress.failed += batch.errors.size();
+        reused.insert(reused.end(), batch.reused.begin(), batch.reused.end());
+        for (auto& record : batch.records) records.push_back(std::move(record));
+        for (const LoadError& error : batch.errors) {
+          if (errorHandler) errorHandler(error);
+        }
+        if (batchHandler && !batch.torrents.empty())
+          batchHandler(std::move(batch.torrents));
+        if (progressHandler) progressHandler(progress);
+      }
+    } catch (...) {
+      // Batches still queued read `paths` and the cache, which are about
+      // to go out of scope
+      for (auto& batch : pending) {
+        if (batch.valid()) batch.wait();
+      }
+      cache = nullptr;
+      throw;
+    }
+    cache = nullptr;
+
+    if (opened && (!records.empty() || reused.size() != opened->size())) {
+      std::vector<std::string_view> views(records.begin(), records.end());
+      for (size_t entry : reused) views.push_back(opened->record(entry));
+      try {
+        MetainfoCache::write(cachePath, views);
+      } catch (const std::exception& e) {
+        if (errorHandler) errorHandler({cachePath, e.what()});
+      }
+    }
+    return progress;
+  }
+
+ private:
+  struct Batch {
+    std::vector<LoadedTorrent> torrents;
+    std::vector<LoadError> errors;
+    std::vector<std::string> records;  // Cache records of parsed files
+    std::vector<size_t> reused;        // Cache entries restored
+  };
+
+  Batch loadBatch(const std::vector<std::string>& paths, size_t begin,
+                  size_t end) const {
+    Batch batch;
+    batch.torrents.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+      try {
+        // Stat before reading, so a file changed meanwhile is seen as stale
+        std::optional<MetainfoCache::Source> source;
+        if (cache) source = MetainfoCache::Source::of(paths[i]);
+        if (source) {
+          if (auto entry = cache->find(*source)) {
+            try {
+              batch.torrents.push_back({paths[i], cache->load(*entry)});
+              batch.reused.push_back(*entry);
+              continue;
+            } catch (const std::runtime_error&) {
+              // A damaged record; decode the file instead
+            }
+          }
+        }
+        // The metainfo copies what it keeps, so the mapping can go at once
+        MappedFile file(paths[i]);
+        batch.torrents.push_back(
+            {paths[i], TorrentMetainfo::parse(file.view())});
+        if (source) {
+          batch.records.push_back(MetainfoCache::makeRecord(
+              batch.torrents.back().metainfo, *source));
+        }
+      } catch (const std::exception& e) {
+        batch.errors.push_back({paths[i], e.what()});
+      }
+    }
+    return batch;
+  }
+
+  ThreadPool& pool;
+  size_t batchSize;
+  BatchHandler batchHandler;
+  ErrorHandler errorHandler;
+  ProgressHandler progressHandler;
+  std::string cachePath;
+  const MetainfoCache* cache = nullptr;  // Open for the duration of load()
+};
+
+#endif
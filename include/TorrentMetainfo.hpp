@@ -0,0 +1,498 @@
+#ifndef TORRENT_METAINFO_HPP
+#define TORRENT_METAINFO_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MerkleTree.hpp"
+#include "TorrentParser.hpp"
+#include "sha1.h"
+
+// Typed model of a .torrent file. Piece hashes are kept as one contiguous
+// array with a 20-byte stride and the file list as a prefix-sum table of
+// byte offsets, so mapping a piece or block to the files it covers is a
+// binary search followed by a short walk, with no allocation.
+//
+// v2 torrents hash each file separately, so their files are laid out with
+// padding up to the next piece boundary, as hybrid torrents spell out with
+// BEP 47 pad files; piece indices then mean the same in v1 and v2.
+class TorrentMetainfo {
+ public:
+  using PieceHash = std::array<uint8_t, 20>;
+
+  struct File {
+    std::string path;  // Components joined with '/', torrent name first
+    uint64_t length;
+    uint64_t offset;  // Position of the file in the torrent's byte stream
+    bool pad = false;  // Alignment filler, all zeros and never stored
+    MerkleTree::Hash piecesRoot{};  // v2: root of the file's hash tree
+    size_t layer = 0;  // v2: index of the file's first piece-layer hash
+  };
+
+  // What a piece hashes to in v2: the root of a subtree over `width`
+  // 16 KiB leaves, of which the first `blocks` hold data
+  struct MerklePiece {
+    MerkleTree::Hash root;
+    size_t blocks;
+    size_t width;
+  };
+
+  // Part of a piece or block that falls inside one file
+  struct FileSlice {
+    size_t file;
+    uint64_t offset;  // Within the file
+    uint64_t length;
+  };
+
+  // Parse and validate a .torrent file: v1, v2 (BEP 52) or hybrid
+  static TorrentMetainfo parse(std::string_view data) {
+    Bencoder bencoder;
+    bencoder.captureKey("info");
+    BencodeView root = bencoder.decodeView(data);
+    // Unsorted or repeated keys would let the fields read and the bytes
+    // hashed come from different places
+    if (!bencoder.isCanonical())
+      throw std::invalid_argument("Torrent is not canonical Bencode");
+    const BencodeView* info = root.find("info");
+    if (!info || !std::holds_alternative<BencodeView::Dict>(info->value))
+      throw std::invalid_argument("Torrent has no info dictionary");
+
+    TorrentMetainfo meta;
+    if (const BencodeView* announce = root.find("announce"))
+      meta.announce = std::string(string(*announce, "announce"));
+    if (const BencodeView* tiers = root.find("announce-list")) {
+      for (const BencodeView& tier : list(*tiers, "announce-list")) {
+        auto& urls = meta.announceList.emplace_back();
+        for (const BencodeView& url : list(tier, "announce-list")) {
+          urls.emplace_back(string(url, "announce-list"));
+        }
+      }
+    }
+    if (const BencodeView* comment = root.find("comment"))
+      meta.comment = std::string(string(*comment, "comment"));
+    if (const BencodeView* date = root.find("creation date"))
+      meta.creationDate = integer(*date, "creation date");
+
+    meta.name = std::string(string(require(*info, "name"), "name"));
+    // The name is the first component of every file path
+    checkComponent(meta.name);
+    int64_t length = integer(require(*info, "piece length"), "piece length");
+    if (length <= 0 || length > int64_t{1} << 30)
+      throw std::invalid_argument("Invalid torrent piece length");
+    meta.pieceLength = static_cast<uint32_t>(length);
+
+    if (const BencodeView* version = info->find("meta version")) {
+      if (integer(*version, "meta version") != 2)
+        throw std::invalid_argument("Unsupported torrent meta version");
+      meta.v2 = true;
+    }
+    auto arrays = std::make_shared<Arrays>();
+    if (const BencodeView* pieces = info->find("pieces")) {
+      meta.v1 = true;
+      meta.parseV1(*info, string(*pieces, "pieces"), *arrays);
+    }
+    if (meta.v2) {
+      if (meta.pieceLength < MerkleTree::blockSize ||
+          (meta.pieceLength & (meta.pieceLength - 1)) != 0)
+        throw std::invalid_argument("Invalid v2 torrent piece length");
+      meta.parseV2(*info, root.find("piece layers"), *arrays);
+    }
+    if (!meta.v1 && !meta.v2)
+      throw std::invalid_argument("Torrent is missing pieces");
+    meta.hashes = arrays->hashes;
+    meta.layers = arrays->layers;
+    meta.storage = std::move(arrays);
+    meta.offsets.push_back(meta.totalLength);
+    std::string_view infoBytes = *bencoder.captured("info");
+    meta.infoHash = SHA1::hash(infoBytes);
+    meta.infoHashV2 = MerkleTree::hashBlock(infoBytes);
+
+    meta.pieceCount = meta.totalLength / meta.pieceLength +
+                      (meta.totalLength % meta.pieceLength != 0);
+    if (meta.v1 && meta.hashes.size() != meta.pieceCount)
+      throw std::invalid_argument("Torrent piece count does not match size");
+    return meta;
+  }
+
+  const std::string& getName() const { return name; }
+  const std::string& getAnnounce() const { return announce; }
+  const std::vector<std::vector<std::string>>& getAnnounceList() const {
+    return announceList;
+  }
+  const std::string& getComment() const { return comment; }
+  int64_t getCreationDate() const { return creationDate; }
+  bool isMultiFile() const { return multiFile; }
+  bool hasV1() const { return v1; }
+  bool hasV2() const { return v2; }
+
+  // SHA-1 of the bencoded info dictionary: the v1 info-hash, used by the
+  // DHT, trackers and the peer handshake of v1 and hybrid torrents
+  const PieceHash& getInfoHash() const { return infoHash; }
+
+  // SHA-256 of the bencoded info dictionary. This is the info-hash of v2
+  // and hybrid torrents; for v1 torrents it still identifies the content.
+  const MerkleTree::Hash& getInfoHashV2() const { return infoHashV2; }
+
+  uint32_t getPieceLength() const { return pieceLength; }
+  size_t getPieceCount() const { return pieceCount; }
+  uint64_t getTotalLength() const { return totalLength; }
+
+  // Size of piece `piece`; only the last one may be short
+  uint32_t getPieceSize(size_t piece) const {
+    checkPiece(piece);
+    uint64_t begin = uint64_t{piece} * pieceLength;
+    return static_cast<uint32_t>(
+        std::min<uint64_t>(pieceLength, totalLength - begin));
+  }
+
+  const PieceHash& getPieceHash(size_t piece) const {
+    checkPiece(piece);
+    if (!v1) throw std::logic_error("Torrent has no v1 piece hashes");
+    checkArrays();
+    return hashes[piece];
+  }
+  // All piece hashes, back to back
+  std::span<const PieceHash> getPieceHashes() const {
+    checkArrays();
+    return hashes;
+  }
+
+  const std::vector<File>& getFiles() const { return files; }
+
+  // Expected v2 hash of piece `piece`. Pieces of files bigger than one
+  // piece come from the piece layers; a smaller file is a single piece
+  // checked against its pieces root.
+  std::optional<MerklePiece> getMerklePiece(size_t piece) const {
+    checkPiece(piece);
+    if (!v2) return std::nullopt;
+    uint64_t begin = uint64_t{piece} * pieceLength;
+    const File& file = files[fileAt(begin)];
+    if (file.pad) return std::nullopt;
+    uint64_t bytes = std::min<uint64_t>(pieceLength,
+                                        file.offset + file.length - begin);
+    size_t blocks = (bytes + MerkleTree::blockSize - 1) / MerkleTree::blockSize;
+    if (file.length <= pieceLength)
+      return MerklePiece{file.piecesRoot, blocks, std::bit_ceil(blocks)};
+    size_t index = file.layer + (begin - file.offset) / pieceLength;
+    checkArrays();
+    return MerklePiece{layers[index], blocks,
+                       pieceLength / MerkleTree::blockSize};
+  }
+
+  // Index of the file holding byte `offset` of the torrent. Empty files
+  // hold no bytes and are never returned.
+  size_t fileAt(uint64_t offset) const {
+    if (offset >= totalLength)
+      throw std::out_of_range("Torrent offset out of range");
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), offset);
+    return static_cast<size_t>(it - offsets.begin()) - 1;
+  }
+
+  // Call f(FileSlice) for each file covered by `length` bytes at `offset`
+  // into piece `piece`, in file order. Empty files are skipped.
+  template <typename F>
+  void forEachSlice(size_t piece, uint32_t offset, uint32_t length,
+                    F&& f) const {
+    if (uint64_t{offset} + length > getPieceSize(piece))
+      throw std::out_of_range("Torrent block out of range");
+    if (length == 0) return;
+    uint64_t begin = uint64_t{piece} * pieceLength + offset;
+    uint64_t remaining = length;
+    for (size_t i = fileAt(begin); remaining > 0; i++) {
+      uint64_t within = begin - files[i].offset;
+      uint64_t take = std::min(remaining, files[i].length - within);
+      if (take == 0) continue;
+      f(FileSlice{i, within, take});
+      begin += take;
+      remaining -= take;
+    }
+  }
+
+  // As above, for the whole piece
+  template <typename F>
+  void forEachSlice(size_t piece, F&& f) const {
+    forEachSlice(piece, 0, getPieceSize(piece), std::forward<F>(f));
+  }
+
+  // Half-open range of file indices piece `piece` touches
+  std::pair<size_t, size_t> fileRange(size_t piece) const {
+    uint64_t begin = uint64_t{piece} * pieceLength;
+    uint64_t end = begin + getPieceSize(piece);
+    return {fileAt(begin), fileAt(end - 1) + 1};
+  }
+
+  // Whether `data` is the content of piece `piece`, pad bytes included.
+  // Hybrid pieces must match both their v1 and v2 hashes.
+  bool verifyPiece(size_t piece, std::string_view data) const {
+    if (data.size() != getPieceSize(piece)) return false;
+    if (v1 && SHA1::hash(data) != getPieceHash(piece)) return false;
+    if (auto merkle = getMerklePiece(piece)) {
+      // Leaves cover the file's bytes only, not the padding after them
+      uint64_t begin = uint64_t{piece} * pieceLength;
+      const File& file = files[fileAt(begin)];
+      data = data.substr(0, file.offset + file.length - begin);
+      std::vector<MerkleTree::Hash> leaves(merkle->blocks);
+      MerkleTree::hashBlocks(data, leaves.data());
+      if (MerkleTree::subtreeRoot(leaves.data(), leaves.size(),
+                                  merkle->width) != merkle->root)
+        return false;
+    }
+    return true;
+  }
+
+ private:
+  friend class MetainfoCache;
+
+  static const BencodeView& require(const BencodeView& dict,
+                                    std::string_view key) {
+    const BencodeView* value = dict.find(key);
+    if (!value)
+      throw std::invalid_argument("Torrent is missing " + std::string(key));
+    return *value;
+  }
+
+  static int64_t integer(const BencodeView& value, std::string_view key) {
+    const auto* i = std::get_if<int64_t>(&value.value);
+    if (!i)
+      throw std::invalid_argument(std::string(key) + " is not an integer");
+    return *i;
+  }
+
+  static std::string_view string(const BencodeView& value,
+                                 std::string_view key) {
+    const auto* s = std::get_if<std::string_view>(&value.value);
+    if (!s)
+      throw std::invalid_argument(std::string(key) + " is not a string");
+    return *s;
+  }
+
+  static const BencodeView::List& list(const BencodeView& value,
+                                       std::string_view key) {
+    const auto* l = std::get_if<BencodeView::List>(&value.value);
+    if (!l) throw std::invalid_argument(std::string(key) + " is not a list");
+    return *l;
+  }
+
+  static const BencodeView::Dict& dict(const BencodeView& value,
+                                       std::string_view key) {
+    const auto* d = std::get_if<BencodeView::Dict>(&value.value);
+    if (!d)
+      throw std::invalid_argument(std::string(key) + " is not a dictionary");
+    return *d;
+  }
+
+  static void checkComponent(std::string_view component) {
+    if (component.empty() || component == "." || component == ".." ||
+        component.find('/') != std::string_view::npos)
+      throw std::invalid_argument("Invalid torrent file path");
+  }
+
+  // Owned storage behind `hashes` and `layers` for a parsed torrent
+  struct Arrays {
+    std::vector<PieceHash> hashes;
+    std::vector<MerkleTree::Hash> layers;
+  };
+
+  // v1: "pieces" and the "files" list or single "length"
+  void parseV1(const BencodeView& info, std::string_view pieces,
+               Arrays& arrays) {
+    if (pieces.size() % sizeof(PieceHash) != 0)
+      throw std::invalid_argument("Torrent pieces are not 20-byte hashes");
+    arrays.hashes.resize(pieces.size() / sizeof(PieceHash));
+    std::memcpy(arrays.hashes.data(), pieces.data(), pieces.size());
+
+    const BencodeView* entries = info.find("files");
+    if (!entries) {
+      addFile(name, integer(require(info, "length"), "length"));
+      return;
+    }
+    multiFile = true;
+    for (const BencodeView& entry : list(*entries, "files")) {
+      std::string path = name;
+      const auto& parts = list(require(entry, "path"), "path");
+      if (parts.empty())
+        throw std::invalid_argument("Invalid torrent file path");
+      for (const BencodeView& part : parts) {
+        std::string_view component = string(part, "path");
+        checkComponent(component);
+        path += '/';
+        path += component;
+      }
+      File& file = addFile(std::move(path),
+                           integer(require(entry, "length"), "length"));
+      if (const BencodeView* attr = entry.find("attr"))
+        file.pad = string(*attr, "attr").find('p') != std::string_view::npos;
+    }
+    if (files.empty())
+      throw std::invalid_argument("Torrent has an empty file list");
+  }
+
+  // v2: the "file tree", checked against the v1 file list of a hybrid
+  // torrent, and the piece layers of every file bigger than one piece
+  void parseV2(const BencodeView& info, const BencodeView* pieceLayers,
+               Arrays& arrays) {
+    std::vector<File> tree;
+    const BencodeView& root = require(info, "file tree");
+    const auto& top = dict(root, "file tree");
+    // A lone top-level file may also be a directory holding one file;
+    // hybrids settle that with their v1 form
+    bool single = v1 ? !multiFile
+                     : top.size() == 1 && top[0].second.find("") != nullptr;
+    walkFileTree(root, single ? "" : name, tree, 0);
+    if (single) tree[0].path = name;
+    if (tree.empty())
+      throw std::invalid_argument("Torrent has an empty file tree");
+
+    if (v1) {
+      size_t next = 0;
+      for (File& file : files) {
+        if (file.pad) continue;
+        if (next == tree.size() || tree[next].path != file.path ||
+            tree[next].length != file.length)
+          throw std::invalid_argument("Hybrid torrent file lists differ");
+        if (file.length > 0 && file.offset % pieceLength != 0)
+          throw std::invalid_argument("Hybrid torrent file is not aligned");
+        file.piecesRoot = tree[next++].piecesRoot;
+      }
+      if (next != tree.size())
+        throw std::invalid_argument("Hybrid torrent file lists differ");
+    } else {
+      multiFile = !single;
+      size_t pads = 0;
+      for (File& file : tree) {
+        uint64_t gap = totalLength % pieceLength;
+        if (gap != 0 && file.length > 0) {
+          addFile(".pad/" + std::to_string(pads++), pieceLength - gap).pad =
+              true;
+        }
+        addFile(std::move(file.path), file.length).piecesRoot =
+            file.piecesRoot;
+      }
+    }
+
+    // Piece layers are keyed by pieces root; sort them once for lookup
+    std::vector<std::pair<std::string_view, std::string_view>> byRoot;
+    if (pieceLayers) {
+      for (const auto& [key, value] : dict(*pieceLayers, "piece layers")) {
+        byRoot.emplace_back(key, string(value, "piece layers"));
+      }
+      std::sort(byRoot.begin(), byRoot.end());
+    }
+    size_t height = MerkleTree::log2(pieceLength / MerkleTree::blockSize);
+    for (File& file : files) {
+      if (file.pad || file.length <= pieceLength) continue;
+      std::string_view key(
+          reinterpret_cast<const char*>(file.piecesRoot.data()),
+          file.piecesRoot.size());
+      auto it = std::lower_bound(byRoot.begin(), byRoot.end(), key,
+                                 [](const auto& entry, std::string_view k) {
+                                   return entry.first < k;
+                                 });
+      if (it == byRoot.end() || it->first != key)
+        throw std::invalid_argument("Torrent is missing a piece layer");
+      uint64_t count = (file.length + pieceLength - 1) / pieceLength;
+      if (it->second.size() != count * sizeof(MerkleTree::Hash))
+        throw std::invalid_argument("Piece layer has the wrong length");
+      std::vector<MerkleTree::Hash> layer(count);
+      std::memcpy(layer.data(), it->second.data(), it->second.size());
+      if (MerkleTree::rootFromLayer(layer, height) != file.piecesRoot)
+        throw std::invalid_argument("Piece layer does not match its root");
+      file.layer = arrays.layers.size();
+      arrays.layers.insert(arrays.layers.end(), layer.begin(), layer.end());
+    }
+  }
+
+  void walkFileTree(const BencodeView& node, const std::string& path,
+                    std::vector<File>& out, size_t depth) {
+    if (depth > 64) throw std::invalid_argument("Torrent file tree too deep");
+    for (const auto& [component, child] : dict(node, "file tree")) {
+      checkComponent(component);
+      std::string childPath =
+          path.empty() ? std::string(component)
+                       : path + '/' + std::string(component);
+      const BencodeView* leaf = child.find("");
+      if (!leaf) {
+        walkFileTree(child, childPath, out, depth + 1);
+        continue;
+      }
+      if (dict(child, "file tree").size() != 1)
+        throw std::invalid_argument("Torrent file tree entry is not a file");
+      int64_t length = integer(require(*leaf, "length"), "length");
+      if (length < 0)
+        throw std::invalid_argument("Invalid torrent file length");
+      File file{std::move(childPath), uint64_t(length), 0};
+      if (length > 0) {
+        std::string_view root =
+            string(require(*leaf, "pieces root"), "pieces root");
+        if (root.size() != file.piecesRoot.size())
+          throw std::invalid_argument("Invalid torrent pieces root");
+        std::memcpy(file.piecesRoot.data(), root.data(), root.size());
+      }
+      out.push_back(std::move(file));
+    }
+  }
+
+  File& addFile(std::string path, int64_t length) {
+    if (length < 0 || uint64_t(length) > UINT64_MAX / 2 - totalLength)
+      throw std::invalid_argument("Invalid torrent file length");
+    offsets.push_back(totalLength);
+    files.push_back({std::move(path), uint64_t(length), totalLength});
+    totalLength += uint64_t(length);
+    return files.back();
+  }
+
+  void checkPiece(size_t piece) const {
+    if (piece >= pieceCount)
+      throw std::out_of_range("Torrent piece index out of range");
+  }
+
+  void checkArrays() const {
+    if (!pending) return;
+    PendingCheck& p = *pending;
+    std::call_once(p.once, [&p] { p.passed = p.check(); });
+    if (!p.passed) throw std::runtime_error("Torrent piece hashes are damaged");
+  }
+
+  std::string name, announce, comment;
+  std::vector<std::vector<std::string>> announceList;
+  int64_t creationDate = 0;
+  bool multiFile = false;
+  bool v1 = false, v2 = false;
+  uint32_t pieceLength = 0;
+  uint64_t totalLength = 0;
+  size_t pieceCount = 0;
+  // Piece hashes and layers point into `storage`: the Arrays built by
+  // parse() or a mapped cache record (see MetainfoCache). Copies share it.
+  std::shared_ptr<const void> storage;
+  std::span<const PieceHash> hashes;
+  std::span<const MerkleTree::Hash> layers;  // All v2 piece layers, by file
+  // Set when the hashes and layers are not yet trusted, as with a cache
+  // record: `check` runs on first use by any copy, and if it fails every
+  // use throws
+  struct PendingCheck {
+    std::function<bool()> check;
+    std::once_flag once;
+    bool passed = false;
+  };
+  std::shared_ptr<PendingCheck> pending;
+  PieceHash infoHash{};
+  MerkleTree::Hash infoHashV2{};
+  std::vector<File> files;
+  // offsets[i] is where file i starts; a final entry holds the total size
+  std::vector<uint64_t> offsets;
+};
+
+#endif
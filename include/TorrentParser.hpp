@@ -1,10 +1,16 @@
 #ifndef TORRENT_PARSER_HPP
 #define TORRENT_PARSER_HPP
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <cstdint>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -25,34 +31,157 @@ class BencodeValue {
 
   // Convert the BencodeValue to a Bencode-encoded string
   std::string toString() const {
-    if (std::holds_alternative<int64_t>(value)) {
-      return "i" + std::to_string(std::get<int64_t>(value)) + "e";
-    } else if (std::holds_alternative<std::string>(value)) {
-      const auto& str = std::get<std::string>(value);
-      return std::to_string(str.size()) + ":" + str;
-    } else if (std::holds_alternative<std::map<KeyType, BencodeValue>>(value)) {
-      const auto& dict = std::get<std::map<KeyType, BencodeValue>>(value);
-      std::string result = "d";
-      for (const auto& [k, v] : dict) {
-        if (std::holds_alternative<int64_t>(k)) {
-          result += "i" + std::to_string(std::get<int64_t>(k)) + "e";
-        } else {
-          const auto& key_str = std::get<std::string>(k);
-          result += std::to_string(key_str.size()) + ":" + key_str;
-        }
-        result += v.toString();
+    std::string result(encodedSize(), '\0');
+    encodeTo(result.data());
+    return result;
+  }
+
+  // Append the encoding to `out`, growing it at most once
+  void appendTo(std::string& out) const {
+    size_t offset = out.size();
+    out.resize(offset + encodedSize());
+    encodeTo(out.data() + offset);
+  }
+
+  // Exact number of bytes the encoding takes
+  size_t encodedSize() const {
+    if (const auto* i = std::get_if<int64_t>(&value)) {
+      return integerSize(*i);
+    } else if (const auto* str = std::get_if<std::string>(&value)) {
+      return stringSize(*str);
+    } else if (const auto* dict =
+                   std::get_if<std::map<KeyType, BencodeValue>>(&value)) {
+      size_t size = 2;
+      for (const auto& [k, v] : *dict) {
+        size += std::holds_alternative<int64_t>(k)
+                    ? integerSize(std::get<int64_t>(k))
+                    : stringSize(std::get<std::string>(k));
+        size += v.encodedSize();
       }
-      result += "e";
-      return result;
+      return size;
+    } else {
+      size_t size = 2;
+      for (const auto& item : std::get<std::vector<BencodeValue>>(value)) {
+        size += item.encodedSize();
+      }
+      return size;
+    }
+  }
+
+  // Write the encoding to an output iterator (or a buffer of at least
+  // encodedSize() bytes) without building intermediate strings; returns the
+  // iterator past the last byte written
+  template <typename OutputIt>
+  OutputIt encodeTo(OutputIt out) const {
+    if (const auto* i = std::get_if<int64_t>(&value)) {
+      return writeInteger(*i, out);
+    } else if (const auto* str = std::get_if<std::string>(&value)) {
+      return writeString(*str, out);
+    } else if (const auto* dict =
+                   std::get_if<std::map<KeyType, BencodeValue>>(&value)) {
+      *out++ = 'd';
+      for (const auto& [k, v] : *dict) {
+        out = std::holds_alternative<int64_t>(k)
+                  ? writeInteger(std::get<int64_t>(k), out)
+                  : writeString(std::get<std::string>(k), out);
+        out = v.encodeTo(out);
+      }
+      *out++ = 'e';
+      return out;
     } else {
-      const auto& list = std::get<std::vector<BencodeValue>>(value);
-      std::string result = "l";
-      for (const auto& item : list) {
-        result += item.toString();
+      *out++ = 'l';
+      for (const auto& item : std::get<std::vector<BencodeValue>>(value)) {
+        out = item.encodeTo(out);
       }
-      result += "e";
+      *out++ = 'e';
+      return out;
+    }
+  }
+
+  // Public member to access the variant value
+  ValueType value;
+
+ private:
+  static size_t decimalSize(uint64_t n) {
+    size_t digits = 1;
+    while (n >= 10) {
+      n /= 10;
+      digits++;
+    }
+    return digits;
+  }
+
+  static size_t integerSize(int64_t n) {
+    uint64_t magnitude = n < 0 ? 0 - static_cast<uint64_t>(n) : n;
+    return 2 + (n < 0) + decimalSize(magnitude);
+  }
+
+  static size_t stringSize(const std::string& str) {
+    return decimalSize(str.size()) + 1 + str.size();
+  }
+
+  template <typename OutputIt>
+  static OutputIt writeInteger(int64_t n, OutputIt out) {
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), n).ptr;
+    *out++ = 'i';
+    out = std::copy(digits, end, out);
+    *out++ = 'e';
+    return out;
+  }
+
+  template <typename OutputIt>
+  static OutputIt writeString(const std::string& str, OutputIt out) {
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), str.size()).ptr;
+    out = std::copy(digits, end, out);
+    *out++ = ':';
+    return std::copy(str.begin(), str.end(), out);
+  }
+};
+
+// Non-owning Bencode value: strings are views into the decoded buffer, which
+// must outlive the BencodeView
+class BencodeView {
+ public:
+  using List = std::vector<BencodeView>;
+  using Dict = std::vector<std::pair<std::string_view, BencodeView>>;
+  using ValueType = std::variant<int64_t, std::string_view, List, Dict>;
+
+  // Constructors
+  BencodeView() : value(int64_t{0}) {}
+  BencodeView(int64_t val) : value(val) {}
+  BencodeView(std::string_view str) : value(str) {}
+  BencodeView(List&& list) : value(std::move(list)) {}
+  BencodeView(Dict&& dict) : value(std::move(dict)) {}
+
+  // Look up a dictionary entry, nullptr if absent or not a dictionary
+  const BencodeView* find(std::string_view key) const {
+    const auto* dict = std::get_if<Dict>(&value);
+    if (!dict) return nullptr;
+    for (const auto& [k, v] : *dict) {
+      if (k == key) return &v;
+    }
+    return nullptr;
+  }
+
+  // Copy into an owning BencodeValue
+  BencodeValue toValue() const {
+    if (const auto* i = std::get_if<int64_t>(&value)) {
+      return *i;
+    } else if (const auto* s = std::get_if<std::string_view>(&value)) {
+      return std::string(*s);
+    } else if (const auto* list = std::get_if<List>(&value)) {
+      std::vector<BencodeValue> result;
+      result.reserve(list->size());
+      for (const auto& item : *list) result.push_back(item.toValue());
       return result;
     }
+    std::map<BencodeValue::KeyType, BencodeValue> result;
+    for (const auto& [k, v] : std::get<Dict>(value)) {
+      result[std::string(k)] = v.toValue();
+    }
+    return result;
   }
 
   // Public member to access the variant value
@@ -63,65 +192,233 @@ class BencodeValue {
 class Bencoder {
  public:
   // Decode a Bencode string into a BencodeValue
-  BencodeValue decode(const std::string& str) {
-    this->str = str;
-    ptr = 0;  // Reset the pointer
+  BencodeValue decode(std::string_view str) {
+    start(str);
     return decodeHelper();
   }
 
+  // Decode without copying any string data; the result refers into `str`
+  BencodeView decodeView(std::string_view str) {
+    start(str);
+    return decodeViewHelper();
+  }
+
+  // Remember where the value stored under `key` in the top-level dictionary
+  // starts and ends in the input, e.g. "info" so the info-hash can be taken
+  // over the original bytes without re-encoding
+  void captureKey(const std::string& key) {
+    captures.push_back({key, std::nullopt});
+  }
+
+  // Raw bytes of a captured value from the last decode; they point into the
+  // decoded buffer
+  std::optional<std::string_view> captured(std::string_view key) const {
+    for (const auto& capture : captures) {
+      if (capture.key == key) return capture.raw;
+    }
+    return std::nullopt;
+  }
+
+  // Whether every dictionary in the last decode had strictly ascending keys,
+  // as canonical Bencode requires for hashes over the raw bytes to be stable
+  bool isCanonical() const { return canonical; }
+
   // Encode a BencodeValue into a Bencode string
   std::string encode(const BencodeValue& val) { return val.toString(); }
 
+  // Encode into `out`, reusing its capacity across calls
+  void encode(const BencodeValue& val, std::string& out) {
+    out.clear();
+    val.appendTo(out);
+  }
+
+  // Advance pos past the value starting at data[pos] without decoding it.
+  // Strings are jumped over by their length prefix and nesting is tracked
+  // with a counter, so arbitrarily deep input never recurses.
+  static void skipValue(std::string_view data, size_t& pos) {
+    size_t depth = 0;
+    do {
+      if (pos >= data.size())
+        throw std::invalid_argument("Unexpected end of Bencode data");
+      char c = data[pos];
+      if (c == 'i') {
+        parseInteger(data, pos);
+      } else if (c == 'l' || c == 'd') {
+        depth++;
+        pos++;
+      } else if (c == 'e' && depth > 0) {
+        depth--;
+        pos++;
+      } else if (std::isdigit(static_cast<unsigned char>(c))) {
+        parseString(data, pos);
+      } else {
+        throw std::invalid_argument("Invalid Bencode format");
+      }
+    } while (depth > 0);
+  }
+
+  // Parse "i<digits>e" at data[pos] in place and advance pos past the 'e'
+  static int64_t parseInteger(std::string_view data, size_t& pos) {
+    return parseInteger(data, pos, data.find('e', pos));
+  }
+
+  // As above, with the position of the terminating 'e' already located
+  static int64_t parseInteger(std::string_view data, size_t& pos,
+                              size_t end_pos) {
+    if (end_pos == std::string_view::npos)
+      throw std::invalid_argument("Invalid Bencode integer format");
+    int64_t result = 0;
+    auto [end, ec] =
+        std::from_chars(data.data() + pos + 1, data.data() + end_pos, result);
+    if (ec != std::errc() || end != data.data() + end_pos ||
+        end_pos == pos + 1)
+      throw std::invalid_argument("Invalid Bencode integer format");
+    pos = end_pos + 1;
+    return result;
+  }
+
+  // Parse "<length>:<bytes>" at data[pos] and advance pos past the bytes
+  static std::string_view parseString(std::string_view data, size_t& pos) {
+    return parseString(data, pos, data.find(':', pos));
+  }
+
+  // As above, with the position of the ':' already located
+  static std::string_view parseString(std::string_view data, size_t& pos,
+                                      size_t colon_pos) {
+    if (colon_pos == std::string_view::npos)
+      throw std::invalid_argument("Invalid Bencode string format");
+    uint64_t len = 0;
+    auto [end, ec] =
+        std::from_chars(data.data() + pos, data.data() + colon_pos, len);
+    if (ec != std::errc() || end != data.data() + colon_pos)
+      throw std::invalid_argument("Invalid Bencode string format");
+    pos = colon_pos + 1;
+    if (len > data.size() - pos)
+      throw std::invalid_argument("String length exceeds data size");
+    std::string_view result = data.substr(pos, len);
+    pos += len;
+    return result;
+  }
+
  private:
+  struct Capture {
+    std::string key;
+    std::optional<std::string_view> raw;
+  };
+
+  void start(std::string_view str) {
+    this->str = str;
+    ptr = 0;  // Reset the pointer
+    depth = 0;
+    canonical = true;
+    for (auto& capture : captures) capture.raw.reset();
+  }
+
+  // Read a dictionary key, checking it sorts after the previous one
+  std::string_view readKey(std::string_view& previous, bool first) {
+    if (!std::isdigit(static_cast<unsigned char>(str[ptr])))
+      throw std::invalid_argument("Invalid Bencode dictionary key type");
+    std::string_view key = parseString(str, ptr);
+    if (!first && key <= previous) canonical = false;
+    previous = key;
+    return key;
+  }
+
+  // Called after the value under `key` was decoded from str[begin, ptr). A
+  // captured key that repeats is refused: which copy counts is ambiguous.
+  void valueDecoded(std::string_view key, size_t begin) {
+    if (depth != 1) return;
+    for (auto& capture : captures) {
+      if (capture.key != key) continue;
+      if (capture.raw)
+        throw std::invalid_argument("Duplicate captured dictionary key");
+      capture.raw = str.substr(begin, ptr - begin);
+    }
+  }
+
   BencodeValue decodeHelper() {
+    if (ptr >= str.size())
+      throw std::invalid_argument("Unexpected end of Bencode data");
     if (str[ptr] == 'i') {  // Integer
-      size_t end_pos = str.find('e', ptr);
-      if (end_pos == std::string::npos)
-        throw std::invalid_argument("Invalid Bencode integer format");
-      int64_t result = std::stoll(str.substr(ptr + 1, end_pos - ptr - 1));
-      ptr = end_pos + 1;
-      return result;
+      return parseInteger(str, ptr);
     } else if (str[ptr] == 'd') {  // Dictionary
       ptr++;
+      depth++;
       std::map<BencodeValue::KeyType, BencodeValue> dict;
+      std::string_view previous;
       while (ptr < str.size() && str[ptr] != 'e') {
-        BencodeValue key = decodeHelper();
-        if (!std::holds_alternative<std::string>(key.value)) {
-          throw std::invalid_argument("Invalid Bencode dictionary key type");
-        }
+        std::string_view key = readKey(previous, dict.empty());
+        size_t begin = ptr;
         auto value = decodeHelper();
-        dict[std::get<std::string>(key.value)] = value;
+        valueDecoded(key, begin);
+        // A repeated key keeps its first value, as BencodeView::find does
+        dict.emplace(std::string(key), std::move(value));
       }
       if (ptr == str.size())
         throw std::invalid_argument("Unterminated dictionary");
       ptr++;
+      depth--;
       return dict;
     } else if (str[ptr] == 'l') {  // List
       ptr++;
+      depth++;
       std::vector<BencodeValue> list;
       while (ptr < str.size() && str[ptr] != 'e') {
         list.push_back(decodeHelper());
       }
       if (ptr == str.size()) throw std::invalid_argument("Unterminated list");
       ptr++;
+      depth--;
       return list;
-    } else if (std::isdigit(str[ptr])) {  // String
-      size_t colon_pos = str.find(':', ptr);
-      if (colon_pos == std::string::npos)
-        throw std::invalid_argument("Invalid Bencode string format");
-      int64_t len = std::stoll(str.substr(ptr, colon_pos - ptr));
-      ptr = colon_pos + 1;
-      if (ptr + len > str.size())
-        throw std::invalid_argument("String length exceeds data size");
-      std::string result = str.substr(ptr, len);
-      ptr += len;
-      return result;
+    } else if (std::isdigit(static_cast<unsigned char>(str[ptr]))) {  // String
+      return std::string(parseString(str, ptr));
+    }
+    throw std::invalid_argument("Invalid Bencode format");
+  }
+
+  BencodeView decodeViewHelper() {
+    if (ptr >= str.size())
+      throw std::invalid_argument("Unexpected end of Bencode data");
+    if (str[ptr] == 'i') {  // Integer
+      return parseInteger(str, ptr);
+    } else if (str[ptr] == 'd') {  // Dictionary
+      ptr++;
+      depth++;
+      BencodeView::Dict dict;
+      std::string_view previous;
+      while (ptr < str.size() && str[ptr] != 'e') {
+        std::string_view key = readKey(previous, dict.empty());
+        size_t begin = ptr;
+        dict.emplace_back(key, decodeViewHelper());
+        valueDecoded(key, begin);
+      }
+      if (ptr == str.size())
+        throw std::invalid_argument("Unterminated dictionary");
+      ptr++;
+      depth--;
+      return dict;
+    } else if (str[ptr] == 'l') {  // List
+      ptr++;
+      depth++;
+      BencodeView::List list;
+      while (ptr < str.size() && str[ptr] != 'e') {
+        list.push_back(decodeViewHelper());
+      }
+      if (ptr == str.size()) throw std::invalid_argument("Unterminated list");
+      ptr++;
+      depth--;
+      return list;
+    } else if (std::isdigit(static_cast<unsigned char>(str[ptr]))) {  // String
+      return parseString(str, ptr);
     }
     throw std::invalid_argument("Invalid Bencode format");
   }
 
-  std::string str;
-  size_t ptr = 0;  // Current parsing position
+  std::string_view str;
+  size_t ptr = 0;    // Current parsing position
+  size_t depth = 0;  // Containers entered at the current position
+  bool canonical = true;
+  std::vector<Capture> captures;
 };
 
 #endif
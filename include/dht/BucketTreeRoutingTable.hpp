@@ -0,0 +1,214 @@
+#ifndef BUCKET_TREE_ROUTING_TABLE_HPP
+#define BUCKET_TREE_ROUTING_TABLE_HPP
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "KBucket.hpp"
+#include "RoutingTable.hpp"
+
+// Routing table as the Kademlia bucket tree. It starts as one bucket
+// covering the whole key space. When the bucket that covers the local ID
+// fills up, it splits: nodes sharing one more bit with the local ID move to
+// a new bucket. Only that bucket ever splits, so the tree is a path of
+// buckets, one for each prefix length up to the last, which holds every
+// longer prefix. The table grows with the network it sees rather than with
+// the ID width, and the buckets near the local ID, which answer most
+// lookups, split until they hold all the nodes in their range.
+//
+// The first `wideBuckets` buckets, which each cover a large part of the key
+// space, can hold more than k nodes: 2k, 4k, ... towards the root. More
+// contacts far away mean fewer hops before a lookup gets close to its
+// target.
+class BucketTreeRoutingTable : public RoutingTable {
+ public:
+  static constexpr int maxWideBuckets = 2;
+
+ private:
+  static constexpr int idLength = NodeId::bits;  // Length of node IDs in bits
+
+  NodeId localId;
+  int wideBuckets;
+  int bucketCount = 0;
+  // Bucket i holds k << (wideBuckets - i) nodes while i < wideBuckets, and k
+  // after that. The wide buckets have storage of their own, allocated only
+  // when enabled, so every other bucket stays at k slots.
+  std::unique_ptr<KBucket<(k << 2)>> widest;  // Bucket 0 of two wide ones
+  std::unique_ptr<KBucket<(k << 1)>> wide;    // The last wide bucket
+  std::vector<KBucket<k>> buckets;            // From bucket wideBuckets on
+
+  // Call `f` with bucket `index`, whose type depends on its capacity
+  template <typename F>
+  decltype(auto) withBucket(int index, F&& f) {
+    switch (wideBuckets - index) {
+      case 2:
+        return f(*widest);
+      case 1:
+        return f(*wide);
+      default:
+        return f(buckets[index - wideBuckets]);
+    }
+  }
+
+  template <typename F>
+  decltype(auto) withBucket(int index, F&& f) const {
+    switch (wideBuckets - index) {
+      case 2:
+        return f(std::as_const(*widest));
+      case 1:
+        return f(std::as_const(*wide));
+      default:
+        return f(buckets[index - wideBuckets]);
+    }
+  }
+
+ public:
+  explicit BucketTreeRoutingTable(const Node& localNode, int wideBuckets = 0)
+      : localId(localNode.getId()), wideBuckets(wideBuckets) {
+    if (wideBuckets < 0 || wideBuckets > maxWideBuckets) {
+      throw std::invalid_argument("Wide buckets must be between 0 and " +
+                                  std::to_string(maxWideBuckets));
+    }
+    if (wideBuckets == 2) widest = std::make_unique<KBucket<(k << 2)>>();
+    if (wideBuckets >= 1) wide = std::make_unique<KBucket<(k << 1)>>();
+    addBucket();
+  }
+
+  void addNode(const Node& node) override {
+    Contact contact = Contact::fromNode(node);
+    while (true) {
+      int index = getBucketIndex(node.getId());
+      bool room = withBucket(index, [&](const auto& bucket) {
+        return !bucket.full() || bucket.find(node.getId()) != -1;
+      });
+      if (!room && index == lastBucket() && index < idLength - 1) {
+        split();
+        continue;
+      }
+      // TODO: When the bucket is full, ping its least recently seen node
+      // through the network layer and replace it only if the ping fails
+      withBucket(index, [&](auto& bucket) { bucket.add(contact); });
+      return;
+    }
+  }
+
+  void removeNode(const Node& node) override {
+    const NodeId& id = node.getId();
+    withBucket(getBucketIndex(id), [&](auto& bucket) { bucket.erase(id); });
+  }
+
+  void markResponded(const NodeId& id,
+                     std::chrono::milliseconds rtt) override {
+    withBucket(getBucketIndex(id),
+               [&](auto& bucket) { bucket.responded(id, rtt); });
+  }
+
+  void markFailed(const NodeId& id) override {
+    withBucket(getBucketIndex(id), [&](auto& bucket) { bucket.failed(id); });
+  }
+
+  const Contact* findContact(const NodeId& id) const override {
+    return withBucket(getBucketIndex(id),
+                      [&](const auto& bucket) { return bucket.get(id); });
+  }
+
+  int getBucketCount() const override { return bucketCount; }
+
+  std::vector<Node> getNodesInBucket(int index) const override {
+    if (index >= getBucketCount()) return {};
+    return withBucket(index,
+                      [](const auto& bucket) { return bucketNodes(bucket); });
+  }
+
+  size_t size() const override {
+    size_t total = 0;
+    for (int i = 0; i < bucketCount; i++) {
+      total += withBucket(i, [](const auto& bucket) { return bucket.size; });
+    }
+    return total;
+  }
+
+  std::vector<Node> findClosestNodes(const NodeId& targetId,
+                                     size_t count = k) const override {
+    auto contactsOf = [this](int index) {
+      return withBucket(index,
+                        [](const auto& bucket) { return bucket.contacts(); });
+    };
+    return closestInBuckets(bucketCount, contactsOf, getBucketIndex(targetId),
+                            targetId, count);
+  }
+
+ private:
+  int lastBucket() const { return bucketCount - 1; }
+
+  // Open a new, empty last bucket and return its index
+  int addBucket() {
+    if (bucketCount >= wideBuckets) buckets.emplace_back();
+    return bucketCount++;
+  }
+
+  int getBucketIndex(const NodeId& nodeId) const {
+    // The shared prefix with the local node, with the last bucket taking
+    // every prefix from its own length on
+    size_t prefix = localId.sharedPrefix(nodeId);
+    return static_cast<int>(std::min<size_t>(prefix, lastBucket()));
+  }
+
+  // Take the nodes of `bucket` that share more than `index` bits with the
+  // local ID, least recently seen first, keeping the order of the rest
+  template <typename Bucket>
+  std::vector<Contact> takeDeeper(Bucket& bucket, int index) const {
+    std::vector<Contact> deeper;
+    Bucket kept;
+    for (int i = 0; i < bucket.size; i++) {
+      const Contact& contact = bucket.slots[bucket.order[i]];
+      if (static_cast<int>(localId.sharedPrefix(contact.id)) > index) {
+        deeper.push_back(contact);
+      } else {
+        kept.insert(contact);
+      }
+    }
+    bucket = kept;
+    return deeper;
+  }
+
+  // Move the nodes of the last bucket that share more than its prefix
+  // length with the local ID into a new last bucket, keeping their order
+  void split() {
+    int index = lastBucket();
+    std::vector<Contact> moving = withBucket(
+        index, [&](auto& bucket) { return takeDeeper(bucket, index); });
+
+    // Coming from a wide bucket, more nodes can move than the new bucket
+    // holds. Split it in turn to move nodes further on, then drop its least
+    // recently seen nodes until the rest fit.
+    while (true) {
+      index = addBucket();
+      size_t room =
+          withBucket(index, [](auto& bucket) { return bucket.slots.size(); });
+      std::vector<Contact> deeper;
+      if (moving.size() > room && index < idLength - 1) {
+        auto stays = [&](const Contact& contact) {
+          return static_cast<int>(localId.sharedPrefix(contact.id)) <= index;
+        };
+        auto from = std::stable_partition(moving.begin(), moving.end(), stays);
+        deeper.assign(from, moving.end());
+        moving.erase(from, moving.end());
+      }
+      size_t dropped = moving.size() > room ? moving.size() - room : 0;
+      withBucket(index, [&](auto& bucket) {
+        for (size_t i = dropped; i < moving.size(); i++) {
+          bucket.insert(moving[i]);
+        }
+      });
+      if (deeper.empty()) return;
+      moving = std::move(deeper);
+    }
+  }
+};
+
+#endif  // BUCKET_TREE_ROUTING_TABLE_HPP
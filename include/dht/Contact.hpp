@@ -0,0 +1,89 @@
+#ifndef CONTACT_HPP
+#define CONTACT_HPP
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "Node.hpp"
+#include "NodeId.hpp"
+
+// What the routing table keeps per node, in 48 bytes with no pointers:
+// contacts are copied around by value and packed into bucket arrays.
+// IPv4 addresses are stored IPv4-mapped (::ffff:a.b.c.d) so both families
+// share one 16-byte field.
+struct Contact {
+  NodeId id;
+  std::array<uint8_t, 16> address{};
+  uint32_t lastSeen = 0;  // Unix time in seconds
+  uint16_t port = 0;
+  uint16_t rttMs = 0;     // Last round trip, saturating
+  uint8_t failures = 0;   // Queries unanswered since the last reply
+
+  // The address of `node`, which must be a numeric IPv4 or IPv6 address
+  static Contact fromNode(const Node& node) {
+    Contact contact;
+    contact.id = node.getId();
+    contact.port = node.getPort();
+    contact.lastSeen = static_cast<uint32_t>(node.getLastSeen());
+    std::string ip = node.getAddress();
+    in_addr v4;
+    if (::inet_pton(AF_INET, ip.c_str(), &v4) == 1) {
+      contact.address[10] = contact.address[11] = 0xff;
+      std::memcpy(contact.address.data() + 12, &v4, 4);
+    } else if (::inet_pton(AF_INET6, ip.c_str(), contact.address.data()) !=
+               1) {
+      throw std::invalid_argument("Invalid node address: " + ip);
+    }
+    return contact;
+  }
+
+  Node toNode() const {
+    Node node(id, addressString(), port);
+    node.setLastSeen(lastSeen);
+    return node;
+  }
+
+  bool isIPv4() const {
+    static constexpr uint8_t mapped[12] = {0, 0, 0, 0, 0,    0,
+                                           0, 0, 0, 0, 0xff, 0xff};
+    return std::memcmp(address.data(), mapped, sizeof(mapped)) == 0;
+  }
+
+  std::string addressString() const {
+    char text[INET6_ADDRSTRLEN];
+    if (isIPv4()) {
+      ::inet_ntop(AF_INET, address.data() + 12, text, sizeof(text));
+    } else {
+      ::inet_ntop(AF_INET6, address.data(), text, sizeof(text));
+    }
+    return text;
+  }
+
+  // A reply arrived after `rtt`
+  void responded(std::chrono::milliseconds rtt) {
+    lastSeen = static_cast<uint32_t>(std::time(nullptr));
+    rttMs = static_cast<uint16_t>(
+        std::clamp<std::chrono::milliseconds::rep>(rtt.count(), 0, 0xffff));
+    failures = 0;
+  }
+
+  // A query went unanswered
+  void failed() {
+    if (failures < 0xff) failures++;
+  }
+};
+
+static_assert(std::is_trivially_copyable_v<Contact>);
+static_assert(sizeof(Contact) == 48);
+
+#endif  // CONTACT_HPP
@@ -0,0 +1,76 @@
+#ifndef FLAT_ROUTING_TABLE_HPP
+#define FLAT_ROUTING_TABLE_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "KBucket.hpp"
+#include "RoutingTable.hpp"
+
+// One k-bucket for each of the 160 shared-prefix lengths, allocated up
+// front as a single array. Buckets far from the local ID cover huge parts
+// of the key space but, like the rest, hold at most k nodes.
+class FlatRoutingTable : public RoutingTable {
+ private:
+  static constexpr int idLength = NodeId::bits;  // Length of node IDs in bits
+
+  using Bucket = KBucket<k>;
+
+  NodeId localId;
+  std::vector<Bucket> buckets;
+
+ public:
+  explicit FlatRoutingTable(const Node& localNode)
+      : localId(localNode.getId()), buckets(idLength) {}
+
+  void addNode(const Node& node) override {
+    // TODO: When the bucket is full, ping its least recently seen node
+    // through the network layer and replace it only if the ping fails
+    bucketFor(node.getId()).add(Contact::fromNode(node));
+  }
+
+  void removeNode(const Node& node) override {
+    bucketFor(node.getId()).erase(node.getId());
+  }
+
+  void markResponded(const NodeId& id,
+                     std::chrono::milliseconds rtt) override {
+    bucketFor(id).responded(id, rtt);
+  }
+
+  void markFailed(const NodeId& id) override { bucketFor(id).failed(id); }
+
+  const Contact* findContact(const NodeId& id) const override {
+    return buckets[getBucketIndex(id)].get(id);
+  }
+
+  int getBucketCount() const override { return idLength; }
+
+  std::vector<Node> getNodesInBucket(int index) const override {
+    return bucketNodes(buckets[index]);
+  }
+
+  size_t size() const override {
+    size_t total = 0;
+    for (const Bucket& bucket : buckets) total += bucket.size;
+    return total;
+  }
+
+  std::vector<Node> findClosestNodes(const NodeId& targetId,
+                                     size_t count = k) const override {
+    auto contactsOf = [this](int index) { return buckets[index].contacts(); };
+    return closestInBuckets(idLength, contactsOf, getBucketIndex(targetId),
+                            targetId, count);
+  }
+
+ private:
+  int getBucketIndex(const NodeId& nodeId) const {
+    // Position of the first '1' bit in the XOR distance to the local node
+    size_t prefix = localId.sharedPrefix(nodeId);
+    return static_cast<int>(std::min<size_t>(prefix, idLength - 1));
+  }
+
+  Bucket& bucketFor(const NodeId& id) { return buckets[getBucketIndex(id)]; }
+};
+
+#endif  // FLAT_ROUTING_TABLE_HPP
@@ -0,0 +1,106 @@
+#ifndef K_BUCKET_HPP
+#define K_BUCKET_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+#include "Contact.hpp"
+
+// A k-bucket of at most `Capacity` contacts, packed in slots [0, size).
+// `order` holds the same slot numbers from least to most recently seen.
+template <size_t Capacity>
+struct KBucket {
+  static_assert(Capacity <= 255, "slot numbers are stored in a byte");
+
+  // A full bucket gives up its least recently seen contact after this many
+  // unanswered queries
+  static constexpr uint8_t maxFailures = 3;
+
+  std::array<Contact, Capacity> slots;
+  std::array<uint8_t, Capacity> order;
+  uint8_t size = 0;
+
+  bool full() const { return size >= Capacity; }
+
+  // Contacts in slot order
+  std::span<const Contact> contacts() const { return {slots.data(), size}; }
+
+  int find(const NodeId& id) const {
+    for (int i = 0; i < size; i++) {
+      if (slots[i].id == id) return i;
+    }
+    return -1;
+  }
+
+  // Mark `slot` as the most recently seen
+  void touch(uint8_t slot) {
+    auto it = std::find(order.begin(), order.begin() + size, slot);
+    std::rotate(it, it + 1, order.begin() + size);
+  }
+
+  void insert(const Contact& contact) {
+    slots[size] = contact;
+    order[size] = size;
+    size++;
+  }
+
+  // Move the last slot into the hole so slots stay packed
+  void remove(uint8_t slot) {
+    auto it = std::find(order.begin(), order.begin() + size, slot);
+    std::copy(it + 1, order.begin() + size, it);
+    size--;
+    if (slot != size) {
+      slots[slot] = slots[size];
+      *std::find(order.begin(), order.begin() + size, size) = slot;
+    }
+  }
+
+  const Contact& leastRecent() const { return slots[order[0]]; }
+
+  // Refresh `contact` if present, else insert it if there is room or the
+  // least recently seen contact stopped answering. False if it was dropped.
+  bool add(Contact contact) {
+    int slot = find(contact.id);
+    if (slot != -1) {
+      contact.rttMs = slots[slot].rttMs;
+      slots[slot] = contact;
+      touch(static_cast<uint8_t>(slot));
+    } else if (!full()) {
+      insert(contact);
+    } else if (leastRecent().failures >= maxFailures) {
+      uint8_t stale = order[0];
+      slots[stale] = contact;
+      touch(stale);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  void responded(const NodeId& id, std::chrono::milliseconds rtt) {
+    int slot = find(id);
+    if (slot == -1) return;
+    slots[slot].responded(rtt);
+    touch(static_cast<uint8_t>(slot));
+  }
+
+  void failed(const NodeId& id) {
+    int slot = find(id);
+    if (slot != -1) slots[slot].failed();
+  }
+
+  void erase(const NodeId& id) {
+    int slot = find(id);
+    if (slot != -1) remove(static_cast<uint8_t>(slot));
+  }
+
+  const Contact* get(const NodeId& id) const {
+    int slot = find(id);
+    return slot == -1 ? nullptr : &slots[slot];
+  }
+};
+
+#endif  // K_BUCKET_HPP
@@ -4,10 +4,14 @@
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 #include <thread>
+#include <unordered_set>
 
+#include "BucketTreeRoutingTable.hpp"
+#include "FlatRoutingTable.hpp"
 #include "Network.hpp"
 #include "Node.hpp"
 #include "RoutingTable.hpp"
@@ -16,7 +20,7 @@
 class DHT {
  private:
   Node localNode;
-  RoutingTable routingTable;
+  std::unique_ptr<RoutingTable> routingTable;
   std::unique_ptr<Network> networkLayer;
   std::map<std::string, std::string> dataStore;
 
@@ -24,16 +28,19 @@ class DHT {
   static constexpr int alpha = 3;
 
  public:
-  DHT(uint16_t port)
+  // With `bucketTree` the routing table splits buckets as it learns nodes
+  // near the local ID instead of keeping one fixed bucket per prefix length,
+  // and its first `wideBuckets` buckets hold 4k and 2k nodes
+  DHT(uint16_t port, bool bucketTree = false, int wideBuckets = 0)
       : localNode("", port),
-        routingTable(localNode),
-        networkLayer(std::make_unique<UDPNetwork>(port, routingTable, dataStore)) {}
+        routingTable(makeRoutingTable(localNode, bucketTree, wideBuckets)),
+        networkLayer(std::make_unique<UDPNetwork>(port, *routingTable, dataStore)) {}
 
   void joinNetwork(const std::vector<std::string>& bootstrapNodes) {
     for (const std::string& node : bootstrapNodes) {
       try {
         Node n(node);
-        routingTable.addNode(n);
+        routingTable->addNode(n);
       } catch (const std::exception& e) {
         std::cerr << "Error adding bootstrap node: " << e.what() << std::endl;
       }
@@ -43,11 +50,11 @@ class DHT {
     iterativeFindNode(localNode.getId());
 
     // Store the local node's contact info in the DHT
-    storeValue(localNode.getId(), localNode.getAddress());
+    storeValue(localNode.getId().toHex(), localNode.getAddress());
   }
 
   void run() {
-    std::thread(&UDPNetwork::listenForResponses, networkLayer.get(), std::ref(routingTable), std::ref(dataStore)).detach();
+    std::thread(&UDPNetwork::listenForResponses, networkLayer.get(), std::ref(*routingTable), std::ref(dataStore)).detach();
 
     // TODO: Implement peer connection and data exchange logic here
     // Periodically refresh the routing table
@@ -59,13 +66,13 @@ class DHT {
 
   void refreshRoutingTable() {
     // Iterate through all buckets in the routing table
-    for (int i = 0; i < 160; ++i) {
-      std::vector<Node> nodes = routingTable.getNodesInBucket(i);
+    for (int i = 0; i < routingTable->getBucketCount(); ++i) {
+      std::vector<Node> nodes = routingTable->getNodesInBucket(i);
       for (const Node& node : nodes) {
         // Check if the node is still active
         if (!networkLayer->sendPing(node)) {
           // If not active, remove it from the routing table
-          routingTable.removeNode(node);
+          routingTable->removeNode(node);
         }
       }
     }
@@ -78,7 +85,7 @@ class DHT {
     }
 
     // If not found locally, perform an iterative search
-    std::vector<Node> closestNodes = iterativeFindNode(key);
+    std::vector<Node> closestNodes = iterativeFindNode(NodeId::hash(key));
     for (const Node& node : closestNodes) {
       std::optional<std::string> value =
           networkLayer->sendFindValue(node, key);
@@ -90,7 +97,7 @@ class DHT {
   }
 
   bool storeValue(const std::string& key, const std::string& value) {
-    std::vector<Node> closestNodes = iterativeFindNode(key);
+    std::vector<Node> closestNodes = iterativeFindNode(NodeId::hash(key));
     bool storedSuccessfully = false;
 
     for (const Node& node : closestNodes) {
@@ -108,7 +115,7 @@ class DHT {
   void bootstrap(const std::string& ip, uint16_t port) {
     try {
       Node n(ip, port);
-      routingTable.addNode(n);
+      routingTable->addNode(n);
     } catch (const std::exception& e) {
       std::cerr << "Error bootstrapping to " << ip << ":" << port << ": "
                 << e.what() << std::endl;
@@ -116,8 +123,17 @@ class DHT {
   }
 
  private:
-  std::vector<Node> iterativeFindNode(const std::string& targetId) {
-    std::vector<Node> closestNodes = routingTable.findClosestNodes(targetId);
+  static std::unique_ptr<RoutingTable> makeRoutingTable(const Node& localNode,
+                                                        bool bucketTree,
+                                                        int wideBuckets) {
+    if (bucketTree) {
+      return std::make_unique<BucketTreeRoutingTable>(localNode, wideBuckets);
+    }
+    return std::make_unique<FlatRoutingTable>(localNode);
+  }
+
+  std::vector<Node> iterativeFindNode(const NodeId& targetId) {
+    std::vector<Node> closestNodes = routingTable->findClosestNodes(targetId);
     std::vector<Node> queriedNodes;
     std::vector<Node> newNodes;
 
@@ -139,25 +155,13 @@ class DHT {
         break;
       }
 
-      std::sort(newNodes.begin(), newNodes.end(),
-                [&targetId](const Node& a, const Node& b) {
-                  return xorDistance(a.getId(), targetId) <
-                         xorDistance(b.getId(), targetId);
-                });
-
-      closestNodes.insert(closestNodes.end(), newNodes.begin(), newNodes.end());
-      std::sort(closestNodes.begin(), closestNodes.end(),
-                [&targetId](const Node& a, const Node& b) {
-                  return xorDistance(a.getId(), targetId) <
-                         xorDistance(b.getId(), targetId);
-                });
-
-      auto last = std::unique(closestNodes.begin(), closestNodes.end());
-      closestNodes.erase(last, closestNodes.end());
-
-      if (closestNodes.size() > k) {
-        closestNodes.resize(k);
+      // Merge without duplicates, then keep the k closest
+      std::unordered_set<NodeId> seen;
+      for (const Node& node : closestNodes) seen.insert(node.getId());
+      for (const Node& node : newNodes) {
+        if (seen.insert(node.getId()).second) closestNodes.push_back(node);
       }
+      closestNodes = RoutingTable::selectClosest(closestNodes, targetId, k);
 
       newNodes.clear();
     }
@@ -8,7 +8,7 @@ class Network{
     public:
     // Existing RPC methods
     virtual bool sendPing(const Node& node);  // Returns success/failure
-    virtual std::vector<Node> sendFindNode(const Node& node, const std::string& target_id);
+    virtual std::vector<Node> sendFindNode(const Node& node, const NodeId& target_id);
     virtual bool sendStore(const Node& node, const std::string& key, const std::string& value);
     virtual std::optional<std::string> sendFindValue(const Node& node, const std::string& key);
 
@@ -0,0 +1,136 @@
+#ifndef NODE_ID_HPP
+#define NODE_ID_HPP
+
+#include <array>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../sha1.h"
+
+// 160-bit Kademlia identifier for nodes and keys, as in BEP 5. Stored as
+// five 32-bit words, most significant first, so comparing the words in
+// order compares the numbers; distances are computed a word at a time
+// and nothing allocates.
+class NodeId {
+ public:
+  static constexpr size_t bits = 160;
+  static constexpr size_t size = bits / 8;
+  static constexpr size_t wordCount = bits / 32;
+  using Bytes = std::array<uint8_t, size>;
+  using Words = std::array<uint32_t, wordCount>;
+
+  constexpr NodeId() = default;
+  constexpr explicit NodeId(const Words& words) : words(words) {}
+
+  // Big-endian bytes, as carried in messages
+  static NodeId fromBytes(const Bytes& bytes) {
+    NodeId id;
+    for (size_t i = 0; i < wordCount; i++) {
+      id.words[i] = uint32_t{bytes[i * 4]} << 24 |
+                    uint32_t{bytes[i * 4 + 1]} << 16 |
+                    uint32_t{bytes[i * 4 + 2]} << 8 | bytes[i * 4 + 3];
+    }
+    return id;
+  }
+
+  // 40 hex digits, either case
+  static NodeId fromHex(std::string_view hex) {
+    if (hex.size() != size * 2)
+      throw std::invalid_argument("Node ID must be 40 hex digits");
+    NodeId id;
+    for (size_t i = 0; i < hex.size(); i++) {
+      char c = hex[i];
+      uint32_t digit = c >= '0' && c <= '9'   ? c - '0'
+                       : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                       : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                              : 16;
+      if (digit == 16)
+        throw std::invalid_argument("Node ID must be 40 hex digits");
+      id.words[i / 8] |= digit << (28 - 4 * (i % 8));
+    }
+    return id;
+  }
+
+  // Identifier of a key or address: its SHA-1
+  static NodeId hash(std::string_view data) {
+    return fromBytes(SHA1::hash(data));
+  }
+
+  Bytes toBytes() const {
+    Bytes bytes;
+    for (size_t i = 0; i < wordCount; i++) {
+      bytes[i * 4] = static_cast<uint8_t>(words[i] >> 24);
+      bytes[i * 4 + 1] = static_cast<uint8_t>(words[i] >> 16);
+      bytes[i * 4 + 2] = static_cast<uint8_t>(words[i] >> 8);
+      bytes[i * 4 + 3] = static_cast<uint8_t>(words[i]);
+    }
+    return bytes;
+  }
+
+  std::string toHex() const {
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string hex(size * 2, '0');
+    for (size_t i = 0; i < hex.size(); i++) {
+      hex[i] = digits[(words[i / 8] >> (28 - 4 * (i % 8))) & 0xf];
+    }
+    return hex;
+  }
+
+  const Words& getWords() const { return words; }
+
+  // XOR distance
+  NodeId operator^(const NodeId& other) const {
+    NodeId distance;
+    for (size_t i = 0; i < wordCount; i++) {
+      distance.words[i] = words[i] ^ other.words[i];
+    }
+    return distance;
+  }
+
+  // Number of leading bits shared with `other`: 160 for the same ID, 0
+  // when they differ in the top bit. The bucket index of `other` in a
+  // routing table centred on this ID.
+  size_t sharedPrefix(const NodeId& other) const {
+    for (size_t i = 0; i < wordCount; i++) {
+      uint32_t diff = words[i] ^ other.words[i];
+      if (diff != 0) return i * 32 + std::countl_zero(diff);
+    }
+    return bits;
+  }
+
+  // Orders `a` and `b` by their distance to `target`, closest first. Only
+  // the first word where a and b differ decides, so the distances are
+  // never formed.
+  static std::strong_ordering compareDistance(const NodeId& a,
+                                              const NodeId& b,
+                                              const NodeId& target) {
+    for (size_t i = 0; i < wordCount; i++) {
+      if (a.words[i] != b.words[i])
+        return (a.words[i] ^ target.words[i]) <=>
+               (b.words[i] ^ target.words[i]);
+    }
+    return std::strong_ordering::equal;
+  }
+
+  auto operator<=>(const NodeId&) const = default;
+
+ private:
+  Words words{};
+};
+
+template <>
+struct std::hash<NodeId> {
+  size_t operator()(const NodeId& id) const noexcept {
+    // IDs are hash output already, so any 64 bits will do
+    const auto& words = id.getWords();
+    return static_cast<size_t>(uint64_t{words[0]} << 32 | words[1]);
+  }
+};
+
+#endif  // NODE_ID_HPP
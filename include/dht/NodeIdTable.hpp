@@ -0,0 +1,136 @@
+#ifndef NODE_ID_TABLE_HPP
+#define NODE_ID_TABLE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "NodeId.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NODE_ID_TABLE_X86 1
+#endif
+
+// Node IDs stored as a structure of arrays: the top 64 bits of every ID
+// in one contiguous array, the remaining words in three more. Distances
+// to a target are then one vector XOR per few IDs over the first array,
+// giving each ID a 64-bit key that orders it by distance; the other words
+// only break ties between keys, which for random IDs almost never happen.
+// The leading zeros of a key are the ID's bucket index relative to the
+// target while they are under 64.
+class NodeIdTable {
+ public:
+  size_t size() const { return high.size(); }
+  void reserve(size_t count) {
+    high.reserve(count);
+    for (auto& words : low) words.reserve(count);
+  }
+  void clear() {
+    high.clear();
+    for (auto& words : low) words.clear();
+  }
+
+  // Append `id`; its index is the previous size()
+  void add(const NodeId& id) {
+    const auto& words = id.getWords();
+    high.push_back(uint64_t{words[0]} << 32 | words[1]);
+    for (size_t i = 0; i < low.size(); i++) low[i].push_back(words[i + 2]);
+  }
+
+  NodeId get(size_t index) const {
+    return NodeId({static_cast<uint32_t>(high[index] >> 32),
+                   static_cast<uint32_t>(high[index]), low[0][index],
+                   low[1][index], low[2][index]});
+  }
+
+  // keys[i] = top 64 bits of get(i) ^ target, for every entry
+  void distanceKeys(const NodeId& target, uint64_t* keys) const {
+    const auto& words = target.getWords();
+    uint64_t t = uint64_t{words[0]} << 32 | words[1];
+#ifdef NODE_ID_TABLE_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) {
+      keysAVX2(high.data(), size(), t, keys);
+      return;
+    }
+#endif
+    xorKeys<Vec2>(high.data(), size(), t, keys);
+  }
+
+  // Indices of the `count` entries closest to `target`, closest first:
+  // one pass computes the keys, a second keeps the best `count` in a
+  // max-heap, so most entries cost a single comparison with its top
+  std::vector<size_t> closest(const NodeId& target, size_t count) const {
+    if (count == 0) return {};
+    std::vector<uint64_t> keys(size());
+    distanceKeys(target, keys.data());
+    const auto& t = target.getWords();
+    using Entry = std::pair<uint64_t, size_t>;  // Key and index
+    auto closer = [&](const Entry& a, const Entry& b) {
+      if (a.first != b.first) return a.first < b.first;
+      for (size_t i = 0; i < low.size(); i++) {
+        uint32_t da = low[i][a.second] ^ t[i + 2];
+        uint32_t db = low[i][b.second] ^ t[i + 2];
+        if (da != db) return da < db;
+      }
+      return a.second < b.second;
+    };
+
+    count = std::min(count, size());
+    std::vector<Entry> best;
+    best.reserve(count);
+    for (size_t i = 0; i < count; i++) best.emplace_back(keys[i], i);
+    std::make_heap(best.begin(), best.end(), closer);
+    for (size_t i = count; i < keys.size(); i++) {
+      // Cheap reject on the key alone; ties go to the full comparison
+      if (keys[i] > best.front().first) continue;
+      Entry entry{keys[i], i};
+      if (!closer(entry, best.front())) continue;
+      std::pop_heap(best.begin(), best.end(), closer);
+      best.back() = entry;
+      std::push_heap(best.begin(), best.end(), closer);
+    }
+    std::sort_heap(best.begin(), best.end(), closer);
+
+    std::vector<size_t> indices(count);
+    for (size_t i = 0; i < count; i++) indices[i] = best[i].second;
+    return indices;
+  }
+
+ private:
+  // GCC vector extensions: operators apply lane by lane
+  using Vec2 = uint64_t __attribute__((vector_size(16)));
+  using Vec4 = uint64_t __attribute__((vector_size(32)));
+
+  template <typename V>
+  __attribute__((always_inline)) static inline void xorKeys(
+      const uint64_t* ids, size_t count, uint64_t target, uint64_t* keys) {
+    constexpr size_t N = sizeof(V) / sizeof(uint64_t);
+    V t = V{} + target;
+    size_t i = 0;
+    for (; i + N <= count; i += N) {
+      V v;
+      std::memcpy(&v, ids + i, sizeof(v));
+      v ^= t;
+      std::memcpy(keys + i, &v, sizeof(v));
+    }
+    for (; i < count; i++) keys[i] = ids[i] ^ target;
+  }
+
+#ifdef NODE_ID_TABLE_X86
+  __attribute__((target("avx2"))) static void keysAVX2(const uint64_t* ids,
+                                                       size_t count,
+                                                       uint64_t target,
+                                                       uint64_t* keys) {
+    xorKeys<Vec4>(ids, count, target, keys);
+  }
+#endif
+
+  std::vector<uint64_t> high;  // Words 0 and 1 of each ID
+  std::array<std::vector<uint32_t>, NodeId::wordCount - 2> low;
+};
+
+#endif  // NODE_ID_TABLE_HPP
@@ -1,98 +1,102 @@
 #ifndef ROUTING_TABLE_HPP
 #define ROUTING_TABLE_HPP
 
-#include <list>
+#include <chrono>
 #include <vector>
 
+#include "Contact.hpp"
 #include "Node.hpp"
+#include "NodeIdTable.hpp"
 
+// Kademlia routing table interface. Buckets are numbered by the length of
+// the prefix their nodes share with the local ID; the last bucket may also
+// hold every longer prefix. See FlatRoutingTable and
+// BucketTreeRoutingTable.
 class RoutingTable {
- private:
-  Node localNode;
-  std::vector<std::list<Node>> buckets;
-  static constexpr int k = 20;       // Maximum number of nodes per bucket
-  static constexpr int idLength = 160;  // Length of node IDs in bits
-
  public:
-  explicit RoutingTable(const Node& localNode) : localNode(localNode) {
-    buckets.resize(idLength);
-  }
-
-  void addNode(const Node& node) {
-    int bucketIndex = getBucketIndex(node.getId());
-    std::list<Node>& bucket = buckets[bucketIndex];
-
-    auto it = std::find(bucket.begin(), bucket.end(), node);
-    if (it != bucket.end()) {
-      // Node already exists, move it to the end (most recently seen)
-      bucket.erase(it);
-      bucket.push_back(node);
-    } else {
-      // New node
-      if (bucket.size() < k) {
-        bucket.push_back(node);
-      } else {
-        // Bucket full, ping the least recently seen node
-        Node& lruNode = bucket.front();
-        // TODO: Implement ping functionality in the network layer
-        // If ping fails, replace lruNode with the new node
-        // Otherwise, discard the new node
-      }
+  static constexpr int k = 20;  // Nodes returned by a lookup
+
+  virtual ~RoutingTable() = default;
+
+  virtual void addNode(const Node& node) = 0;
+  virtual void removeNode(const Node& node) = 0;
+
+  // Record a reply from `id` after `rtt`; it becomes the most recently seen
+  virtual void markResponded(const NodeId& id,
+                             std::chrono::milliseconds rtt) = 0;
+  // Record a query to `id` that went unanswered
+  virtual void markFailed(const NodeId& id) = 0;
+
+  virtual const Contact* findContact(const NodeId& id) const = 0;
+
+  virtual int getBucketCount() const = 0;
+  // Nodes of bucket `index`, least recently seen first
+  virtual std::vector<Node> getNodesInBucket(int index) const = 0;
+  virtual size_t size() const = 0;
+
+  // The `count` nodes closest to `targetId`, closest first
+  virtual std::vector<Node> findClosestNodes(const NodeId& targetId,
+                                             size_t count = k) const = 0;
+
+  // The `count` nodes of `candidates` closest to `targetId`, closest first
+  static std::vector<Node> selectClosest(const std::vector<Node>& candidates,
+                                         const NodeId& targetId,
+                                         size_t count) {
+    NodeIdTable ids;
+    ids.reserve(candidates.size());
+    for (const Node& node : candidates) ids.add(node.getId());
+    std::vector<Node> closest;
+    for (size_t index : ids.closest(targetId, count)) {
+      closest.push_back(candidates[index]);
     }
+    return closest;
   }
 
-  std::vector<Node> findClosestNodes(const std::string& targetId) const {
-    int bucketIndex = getBucketIndex(targetId);
-    std::vector<Node> closestNodes;
-
-    // Add nodes from the target bucket
-    for (const Node& node : buckets[bucketIndex]) {
-      closestNodes.push_back(node);
-    }
-
-    // If fewer than k nodes in the target bucket, check adjacent buckets
-    for (int i = 1; closestNodes.size() < k && (bucketIndex - i >= 0 || bucketIndex + i < idLength); ++i) {
-      if (bucketIndex - i >= 0) {
-        for (const Node& node : buckets[bucketIndex - i]) {
-          closestNodes.push_back(node);
-        }
+ protected:
+  // Closest-nodes query over `bucketCount` buckets, where `contactsOf(i)`
+  // gives the contacts of bucket i, for a target in bucket d. Every node in
+  // bucket d is closer to the target than any node in buckets above d,
+  // which in turn are all closer than bucket d - 1, then d - 2 and so on.
+  // Buckets are taken in that order until `count` nodes are in hand; later
+  // buckets cannot improve on them.
+  template <typename ContactsOf>
+  static std::vector<Node> closestInBuckets(int bucketCount,
+                                            ContactsOf contactsOf, int d,
+                                            const NodeId& targetId,
+                                            size_t count) {
+    std::vector<const Contact*> candidates;
+    auto gather = [&](int index) {
+      for (const Contact& contact : contactsOf(index)) {
+        candidates.push_back(&contact);
       }
-      if (bucketIndex + i < idLength) {
-        for (const Node& node : buckets[bucketIndex + i]) {
-          closestNodes.push_back(node);
-        }
-      }
-    }
+    };
 
-    // Sort by distance to the target
-    std::sort(closestNodes.begin(), closestNodes.end(),
-              [&targetId](const Node& a, const Node& b) {
-                return xorDistance(a.getId(), targetId) <
-                       xorDistance(b.getId(), targetId);
-              });
-
-    // Return at most k nodes
-    if (closestNodes.size() > k) {
-      closestNodes.resize(k);
+    int last = bucketCount - 1;
+    gather(d);
+    if (candidates.size() < count) {
+      for (int i = d + 1; i <= last; i++) gather(i);
     }
-
-    return closestNodes;
+    for (int i = d - 1; i >= 0 && candidates.size() < count; i--) gather(i);
+
+    // Only the last bucket taken can hold more nodes than needed
+    NodeIdTable ids;
+    ids.reserve(candidates.size());
+    for (const Contact* contact : candidates) ids.add(contact->id);
+    std::vector<Node> closest;
+    for (size_t index : ids.closest(targetId, count)) {
+      closest.push_back(candidates[index]->toNode());
+    }
+    return closest;
   }
 
- private:
-  int getBucketIndex(const std::string& nodeId) const {
-    // Calculate the XOR distance between the local node ID and the given ID
-    std::string distance = xorDistance(localNode.getId(), nodeId);
-
-    // Find the first '1' bit in the distance (most significant bit)
-    for (int i = 0; i < idLength; ++i) {
-      if (distance[i] == '1') {
-        return i;
-      }
+  template <typename Bucket>
+  static std::vector<Node> bucketNodes(const Bucket& bucket) {
+    std::vector<Node> nodes;
+    for (int i = 0; i < bucket.size; i++) {
+      nodes.push_back(bucket.slots[bucket.order[i]].toNode());
     }
-
-    return idLength - 1; // Should ideally never reach here
+    return nodes;
   }
 };
 
-#endif  // ROUTING_TABLE_HPP
\ No newline at end of file
+#endif  // ROUTING_TABLE_HPP
@@ -1,6 +1,7 @@
 #ifndef UDP_NETWORK_HPP
 #define UDP_NETWORK_HPP
 
+#include <cctype>
 #include <mutex>
 #include <unordered_map>
 #include <sys/socket.h>
@@ -36,11 +37,11 @@ class UDPNetwork : public Network{
             return false;
         }
     }
-    std::vector<Node> sendFindNode(const Node& node, const std::string& target_id) override {
+    std::vector<Node> sendFindNode(const Node& node, const NodeId& target_id) override {
         Message find_node_msg;
         find_node_msg.type = MessageType::FIND_NODE;
         find_node_msg.message_id = generateMessageId();
-        find_node_msg.payload["target_id"] = target_id;
+        find_node_msg.payload["target_id"] = target_id.toHex();
         sendMessage(node, find_node_msg);
 
         if (waitForResponse(find_node_msg.message_id, request_timeout)) {
@@ -95,19 +96,7 @@ class UDPNetwork : public Network{
             responses[response.message_id] = true;
         } else if (response.type == MessageType::FIND_NODE_RESPONSE) {
             if (response.payload.count("nodes") > 0) {
-                // Assuming nodes are sent as a comma-separated string of "ip:port" pairs
-                std::string nodes_str = response.payload.at("nodes");
-                std::vector<Node> nodes;
-                std::stringstream ss(nodes_str);
-                std::string node_str;
-                while (std::getline(ss, node_str, ',')) {
-                    std::stringstream node_ss(node_str);
-                    std::string ip, port_str;
-                    std::getline(node_ss, ip, ':');
-                    std::getline(node_ss, port_str);
-                    nodes.emplace_back(ip, std::stoi(port_str));
-                }
-                received_nodes[response.message_id] = nodes;
+                received_nodes[response.message_id] = decodeNodes(response.payload.at("nodes"));
             }
         } else if (response.type == MessageType::FIND_VALUE_RESPONSE) {
             if (response.payload.count("value") > 0) {
@@ -119,23 +108,26 @@ class UDPNetwork : public Network{
             response.message_id = generateMessageId();
             sendMessage(from, response);
         } else if (response.type == MessageType::FIND_NODE) {
-            std::string target_id = response.payload.at("target_id");
-            std::vector<Node> closest_nodes = routingTable.findClosestNodes(target_id);
-
-            std::string nodes_str;
-            for (const Node& node : closest_nodes) {
-                nodes_str += node.getAddress() + ",";
-            }
-            if (!nodes_str.empty()) {
-                nodes_str.pop_back(); // Remove trailing comma
+            auto target = response.payload.find("target_id");
+            if (target == response.payload.end()) return;
+            NodeId target_id;
+            try {
+                target_id = NodeId::fromHex(target->second);
+            } catch (const std::invalid_argument&) {
+                return; // Drop a request with a malformed target
             }
+            std::vector<Node> closest_nodes = routingTable.findClosestNodes(target_id);
 
             Message response;
             response.type = MessageType::FIND_NODE_RESPONSE;
             response.message_id = generateMessageId();
-            response.payload["nodes"] = nodes_str;
+            response.payload["nodes"] = encodeNodes(closest_nodes);
             sendMessage(from, response);
         } else if (response.type == MessageType::STORE) {
+            if (response.payload.count("key") == 0 ||
+                response.payload.count("value") == 0) {
+                return;
+            }
             std::string key = response.payload.at("key");
             std::string value = response.payload.at("value");
             dataStore[key] = value; // Store the key-value pair
@@ -145,6 +137,7 @@ class UDPNetwork : public Network{
             response.message_id = generateMessageId();
             sendMessage(from, response);
         } else if (response.type == MessageType::FIND_VALUE) {
+            if (response.payload.count("key") == 0) return;
             std::string key = response.payload.at("key");
             if (dataStore.count(key) > 0) {
                 Message response;
@@ -154,21 +147,13 @@ class UDPNetwork : public Network{
                 sendMessage(from, response);
             } else {
                 // If value not found, treat as FIND_NODE
-                std::string target_id = key;
+                NodeId target_id = NodeId::hash(key);
                 std::vector<Node> closest_nodes = routingTable.findClosestNodes(target_id);
 
-                std::string nodes_str;
-                for (const Node& node : closest_nodes) {
-                    nodes_str += node.getAddress() + ",";
-                }
-                if (!nodes_str.empty()) {
-                    nodes_str.pop_back(); // Remove trailing comma
-                }
-
                 Message response;
                 response.type = MessageType::FIND_NODE_RESPONSE;
                 response.message_id = generateMessageId();
-                response.payload["nodes"] = nodes_str;
+                response.payload["nodes"] = encodeNodes(closest_nodes);
                 sendMessage(from, response);
             }
         }
@@ -177,7 +162,7 @@ class UDPNetwork : public Network{
         int socket_fd;
         std::chrono::milliseconds request_timeout = std::chrono::milliseconds(5000);
         uint16_t port;
-        std::unordered_map<std::string,bool>active_connections;
+        std::unordered_map<NodeId,bool>active_connections;
         std::mutex connections_mutex;
         std::unordered_map<std::string, bool> responses;
         std::unordered_map<std::string, std::vector<Node>> received_nodes;
@@ -209,12 +194,18 @@ class UDPNetwork : public Network{
                                                   (struct sockaddr*)&client_addr, &client_addr_len);
 
                 if (bytes_received > 0) {
-                    std::string received_data(buffer, bytes_received);
-                    Message response = Message::deserialize(received_data);
-                    std::string ip_address = inet_ntoa(client_addr.sin_addr);
-                    std::string address = ip_address + ":" + std::to_string(ntohs(client_addr.sin_port));
-                    Node from(ip_address, ntohs(client_addr.sin_port));
-                    handleResponse(from, response, routingTable, dataStore);
+                    // A malformed datagram from a peer is dropped rather
+                    // than allowed to end this thread and the process
+                    try {
+                        std::string received_data(buffer, bytes_received);
+                        Message response = Message::deserialize(received_data);
+                        std::string ip_address = inet_ntoa(client_addr.sin_addr);
+                        std::string address = ip_address + ":" + std::to_string(ntohs(client_addr.sin_port));
+                        Node from(ip_address, ntohs(client_addr.sin_port));
+                        handleResponse(from, response, routingTable, dataStore);
+                    } catch (const std::invalid_argument&) {
+                    } catch (const std::out_of_range&) {
+                    }
                 }
             }
         }
@@ -232,6 +223,44 @@ class UDPNetwork : public Network{
             }
             return false;
         }
+        // Nodes travel as a comma-separated list of "<40 hex id>@ip:port"
+        static std::string encodeNodes(const std::vector<Node>& nodes) {
+            std::string nodes_str;
+            for (const Node& node : nodes) {
+                if (!nodes_str.empty()) nodes_str += ',';
+                nodes_str += node.getId().toHex() + "@" + node.getAddress() +
+                             ":" + std::to_string(node.getPort());
+            }
+            return nodes_str;
+        }
+        static std::vector<Node> decodeNodes(const std::string& nodes_str) {
+            std::vector<Node> nodes;
+            std::stringstream ss(nodes_str);
+            std::string node_str;
+            while (std::getline(ss, node_str, ',')) {
+                size_t at = node_str.find('@');
+                size_t colon = node_str.rfind(':');
+                if (at == std::string::npos || colon == std::string::npos || colon < at) {
+                    continue;
+                }
+                // Skip entries with a bad ID or port, keep the rest
+                try {
+                    NodeId id = NodeId::fromHex(std::string_view(node_str).substr(0, at));
+                    std::string port_str = node_str.substr(colon + 1);
+                    size_t used = 0;
+                    unsigned long port = std::stoul(port_str, &used);
+                    if (!std::isdigit(static_cast<unsigned char>(port_str[0])) ||
+                        used != port_str.size() || port > 65535) {
+                        continue;
+                    }
+                    nodes.emplace_back(id, node_str.substr(at + 1, colon - at - 1),
+                                       static_cast<uint16_t>(port));
+                } catch (const std::invalid_argument&) {
+                } catch (const std::out_of_range&) {
+                }
+            }
+            return nodes;
+        }
         std::string generateMessageId() {
             static std::random_device rd;
             static std::mt19937 gen(rd());
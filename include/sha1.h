@@ -0,0 +1,287 @@
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+// SHA-1, as BitTorrent v1 uses for info-hashes and piece hashes. Whole
+// blocks are compressed straight from the caller's buffer; on x86 CPUs with
+// the SHA extensions the compression runs on SHA-NI, picked once via CPUID.
+class SHA1 {
+
+public:
+	using Digest = std::array<uint8_t, 20>;
+
+	// hardware = false forces the portable implementation
+	explicit SHA1(bool hardware = true);
+	void update(const uint8_t * data, size_t length);
+	void update(std::string_view data);
+	Digest digest();
+
+	// One-shot hash of `data`
+	static Digest hash(std::string_view data);
+	static std::string toString(const Digest & digest);
+	// Whether the SHA-NI path is available on this CPU
+	static bool hardwareAccelerated();
+
+private:
+	using Compress = void (*)(uint32_t * state, const uint8_t * blocks,
+	                          size_t count);
+
+	uint8_t  m_data[64];
+	uint32_t m_blocklen;
+	uint64_t m_bitlen;
+	uint32_t m_state[5]; //A, B, C, D, E
+	Compress m_compress;
+
+	static Compress select();
+	static uint32_t rotl(uint32_t x, uint32_t n);
+	static void compressScalar(uint32_t * state, const uint8_t * blocks,
+	                           size_t count);
+#if defined(__x86_64__) || defined(__i386__)
+	static void compressShaNi(uint32_t * state, const uint8_t * blocks,
+	                          size_t count);
+#endif
+};
+
+
+
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+inline SHA1::SHA1(bool hardware): m_blocklen(0), m_bitlen(0),
+	m_compress(hardware ? select() : compressScalar) {
+	m_state[0] = 0x67452301;
+	m_state[1] = 0xefcdab89;
+	m_state[2] = 0x98badcfe;
+	m_state[3] = 0x10325476;
+	m_state[4] = 0xc3d2e1f0;
+}
+
+inline void SHA1::update(const uint8_t * data, size_t length) {
+	// Top up a partial block first
+	if (m_blocklen > 0) {
+		size_t take = std::min<size_t>(64 - m_blocklen, length);
+		memcpy(m_data + m_blocklen, data, take);
+		m_blocklen += take;
+		data += take;
+		length -= take;
+		if (m_blocklen < 64) {
+			return;
+		}
+		m_compress(m_state, m_data, 1);
+		m_bitlen += 512;
+		m_blocklen = 0;
+	}
+
+	// Whole blocks straight from the input
+	size_t blocks = length / 64;
+	if (blocks > 0) {
+		m_compress(m_state, data, blocks);
+		m_bitlen += uint64_t{blocks} * 512;
+		data += blocks * 64;
+		length -= blocks * 64;
+	}
+
+	if (length > 0) {
+		memcpy(m_data, data, length);
+		m_blocklen = length;
+	}
+}
+
+inline void SHA1::update(std::string_view data) {
+	update(reinterpret_cast<const uint8_t*> (data.data()), data.size());
+}
+
+inline SHA1::Digest SHA1::digest() {
+	// Append a bit 1, zeros and the length in bits
+	m_bitlen += m_blocklen * 8;
+	m_data[m_blocklen++] = 0x80;
+	if (m_blocklen > 56) {
+		memset(m_data + m_blocklen, 0, 64 - m_blocklen);
+		m_compress(m_state, m_data, 1);
+		m_blocklen = 0;
+	}
+	memset(m_data + m_blocklen, 0, 56 - m_blocklen);
+	for (uint8_t i = 0 ; i < 8 ; i++) {
+		m_data[63 - i] = m_bitlen >> (i * 8);
+	}
+	m_compress(m_state, m_data, 1);
+
+	// SHA uses big endian byte ordering
+	Digest hash;
+	for (uint8_t i = 0 ; i < 20 ; i++) {
+		hash[i] = m_state[i / 4] >> (24 - (i % 4) * 8);
+	}
+	return hash;
+}
+
+inline SHA1::Digest SHA1::hash(std::string_view data) {
+	SHA1 sha;
+	sha.update(data);
+	return sha.digest();
+}
+
+inline std::string SHA1::toString(const Digest & digest) {
+	std::stringstream s;
+	s << std::setfill('0') << std::hex;
+
+	for(uint8_t i = 0 ; i < 20 ; i++) {
+		s << std::setw(2) << (unsigned int) digest[i];
+	}
+
+	return s.str();
+}
+
+inline bool SHA1::hardwareAccelerated() {
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) {
+		return false;
+	}
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+	return ebx & bit_SHA;
+#else
+	return false;
+#endif
+}
+
+inline SHA1::Compress SHA1::select() {
+#if defined(__x86_64__) || defined(__i386__)
+	static const Compress best =
+		hardwareAccelerated() ? compressShaNi : compressScalar;
+	return best;
+#else
+	return compressScalar;
+#endif
+}
+
+inline uint32_t SHA1::rotl(uint32_t x, uint32_t n) {
+	return (x << n) | (x >> (32 - n));
+}
+
+inline void SHA1::compressScalar(uint32_t * state, const uint8_t * blocks,
+                                 size_t count) {
+	for (; count > 0 ; count--, blocks += 64) {
+		uint32_t w[80];
+		for (uint8_t i = 0, j = 0; i < 16; i++, j += 4) {
+			w[i] = (blocks[j] << 24) | (blocks[j + 1] << 16) |
+			       (blocks[j + 2] << 8) | (blocks[j + 3]);
+		}
+		for (uint8_t i = 16 ; i < 80; i++) {
+			w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+		         e = state[4];
+		// One loop per round function, so none of them branch
+		auto round = [&](uint8_t i, uint32_t f, uint32_t k) {
+			uint32_t t = rotl(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = rotl(b, 30);
+			b = a;
+			a = t;
+		};
+		for (uint8_t i = 0; i < 20; i++) {
+			round(i, (b & c) | (~b & d), 0x5a827999);
+		}
+		for (uint8_t i = 20; i < 40; i++) {
+			round(i, b ^ c ^ d, 0x6ed9eba1);
+		}
+		for (uint8_t i = 40; i < 60; i++) {
+			round(i, (b & c) | (b & d) | (c & d), 0x8f1bbcdc);
+		}
+		for (uint8_t i = 60; i < 80; i++) {
+			round(i, b ^ c ^ d, 0xca62c1d6);
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+namespace sha1_detail {
+
+// Four rounds of group `i` (0-19). The message schedule for later groups
+// is computed as it goes: msg1 three groups ahead, the XOR two ahead and
+// msg2 one ahead, each only while those groups exist.
+template <int i>
+__attribute__((always_inline, target("sha,sse4.1")))
+inline void rounds(__m128i & abcd, __m128i (&e)[2], __m128i (&msg)[4]) {
+	__m128i & next = e[i % 2];
+	if constexpr (i == 0) {
+		next = _mm_add_epi32(next, msg[0]);
+	} else {
+		next = _mm_sha1nexte_epu32(next, msg[i % 4]);
+	}
+	e[(i + 1) % 2] = abcd;
+	if constexpr (i >= 3 && i <= 18) {
+		msg[(i + 1) % 4] = _mm_sha1msg2_epu32(msg[(i + 1) % 4], msg[i % 4]);
+	}
+	abcd = _mm_sha1rnds4_epu32(abcd, next, i / 5);
+	if constexpr (i >= 1 && i <= 16) {
+		msg[(i + 3) % 4] = _mm_sha1msg1_epu32(msg[(i + 3) % 4], msg[i % 4]);
+	}
+	if constexpr (i >= 2 && i <= 17) {
+		msg[(i + 2) % 4] = _mm_xor_si128(msg[(i + 2) % 4], msg[i % 4]);
+	}
+}
+
+template <int... I>
+__attribute__((always_inline, target("sha,sse4.1")))
+inline void allRounds(std::integer_sequence<int, I...>, __m128i & abcd,
+                      __m128i (&e)[2], __m128i (&msg)[4],
+                      const uint8_t * block) {
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+	                                    0x08090a0b0c0d0e0fULL);
+	// The first four groups also load their message words
+	((I < 4 ? (void) (msg[I % 4] = _mm_shuffle_epi8(
+	              _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+	                  block + (I % 4) * 16)), mask))
+	        : (void) 0,
+	  rounds<I>(abcd, e, msg)), ...);
+}
+
+}
+
+__attribute__((target("sha,sse4.1")))
+inline void SHA1::compressShaNi(uint32_t * state, const uint8_t * blocks,
+                                size_t count) {
+	__m128i abcd = _mm_shuffle_epi32(
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+	__m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+	for (; count > 0 ; count--, blocks += 64) {
+		__m128i abcdSaved = abcd, e0Saved = e0;
+		__m128i e[2] = {e0, e0};
+		__m128i msg[4];
+		sha1_detail::allRounds(std::make_integer_sequence<int, 20>{}, abcd,
+		                       e, msg, blocks);
+		e0 = _mm_sha1nexte_epu32(e[0], e0Saved);
+		abcd = _mm_add_epi32(abcd, abcdSaved);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state),
+	                 _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+#endif
+#endif
@@ -2,24 +2,39 @@
 #define SHA256_H
 
 #include <string>
+#include <string_view>
 #include <array>
 #include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
 
 class SHA256 {
 
 public:
-	SHA256();
+	using Hex = std::array<char, 65>; // 64 digits and a terminating NUL
+
+	// hardware = false forces the portable implementation
+	explicit SHA256(bool hardware = true);
 	void update(const uint8_t * data, size_t length);
-	void update(const std::string &data);
+	void update(std::string_view data);
 	std::array<uint8_t, 32> digest();
 
 	static std::string toString(const std::array<uint8_t, 32> & digest);
+	// Lowercase hex digest without allocating
+	static Hex toHex(const std::array<uint8_t, 32> & digest);
+	// Whether the SHA-NI path is available on this CPU
+	static bool hardwareAccelerated();
 
 private:
+	using Compress = void (*)(uint32_t * state, const uint8_t * blocks,
+	                          size_t count);
+
 	uint8_t  m_data[64];
 	uint32_t m_blocklen;
 	uint64_t m_bitlen;
 	uint32_t m_state[8]; //A, B, C, D, E, F, G, H
+	Compress m_compress;
 
 	static constexpr std::array<uint32_t, 64> K = {
 		0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,
@@ -40,12 +55,18 @@ private:
 		0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
 	};
 
+	static Compress select();
 	static uint32_t rotr(uint32_t x, uint32_t n);
 	static uint32_t choose(uint32_t e, uint32_t f, uint32_t g);
 	static uint32_t majority(uint32_t a, uint32_t b, uint32_t c);
 	static uint32_t sig0(uint32_t x);
 	static uint32_t sig1(uint32_t x);
-	void transform();
+	static void compressScalar(uint32_t * state, const uint8_t * blocks,
+	                           size_t count);
+#if defined(__x86_64__) || defined(__i386__)
+	static void compressShaNi(uint32_t * state, const uint8_t * blocks,
+	                          size_t count);
+#endif
 	void pad();
 	void revert(std::array<uint8_t, 32> & hash);
 };
@@ -53,12 +74,14 @@ private:
 
 
 #include <cstring>
-#include <sstream>
-#include <iomanip>
 
-constexpr std::array<uint32_t, 64> SHA256::K;
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
-SHA256::SHA256(): m_blocklen(0), m_bitlen(0) {
+inline SHA256::SHA256(bool hardware): m_blocklen(0), m_bitlen(0),
+	m_compress(hardware ? select() : compressScalar) {
 	m_state[0] = 0x6a09e667;
 	m_state[1] = 0xbb67ae85;
 	m_state[2] = 0x3c6ef372;
@@ -69,24 +92,42 @@ SHA256::SHA256(): m_blocklen(0), m_bitlen(0) {
 	m_state[7] = 0x5be0cd19;
 }
 
-void SHA256::update(const uint8_t * data, size_t length) {
-	for (size_t i = 0 ; i < length ; i++) {
-		m_data[m_blocklen++] = data[i];
-		if (m_blocklen == 64) {
-			transform();
-
-			// End of the block
-			m_bitlen += 512;
-			m_blocklen = 0;
+inline void SHA256::update(const uint8_t * data, size_t length) {
+	// Top up a partial block first
+	if (m_blocklen > 0) {
+		size_t take = std::min<size_t>(64 - m_blocklen, length);
+		memcpy(m_data + m_blocklen, data, take);
+		m_blocklen += take;
+		data += take;
+		length -= take;
+		if (m_blocklen < 64) {
+			return;
 		}
+		m_compress(m_state, m_data, 1);
+		m_bitlen += 512;
+		m_blocklen = 0;
+	}
+
+	// Whole blocks straight from the input, without copying
+	size_t blocks = length / 64;
+	if (blocks > 0) {
+		m_compress(m_state, data, blocks);
+		m_bitlen += uint64_t{blocks} * 512;
+		data += blocks * 64;
+		length -= blocks * 64;
+	}
+
+	if (length > 0) {
+		memcpy(m_data, data, length);
+		m_blocklen = length;
 	}
 }
 
-void SHA256::update(const std::string &data) {
-	update(reinterpret_cast<const uint8_t*> (data.c_str()), data.size());
+inline void SHA256::update(std::string_view data) {
+	update(reinterpret_cast<const uint8_t*> (data.data()), data.size());
 }
 
-std::array<uint8_t,32> SHA256::digest() {
+inline std::array<uint8_t,32> SHA256::digest() {
 	std::array<uint8_t,32> hash;
 
 	pad();
@@ -95,70 +136,170 @@ std::array<uint8_t,32> SHA256::digest() {
 	return hash;
 }
 
-uint32_t SHA256::rotr(uint32_t x, uint32_t n) {
+inline bool SHA256::hardwareAccelerated() {
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1)) {
+		return false;
+	}
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+	return ebx & bit_SHA;
+#else
+	return false;
+#endif
+}
+
+inline SHA256::Compress SHA256::select() {
+#if defined(__x86_64__) || defined(__i386__)
+	static const Compress best =
+		hardwareAccelerated() ? compressShaNi : compressScalar;
+	return best;
+#else
+	return compressScalar;
+#endif
+}
+
+inline uint32_t SHA256::rotr(uint32_t x, uint32_t n) {
 	return (x >> n) | (x << (32 - n));
 }
 
-uint32_t SHA256::choose(uint32_t e, uint32_t f, uint32_t g) {
+inline uint32_t SHA256::choose(uint32_t e, uint32_t f, uint32_t g) {
 	return (e & f) ^ (~e & g);
 }
 
-uint32_t SHA256::majority(uint32_t a, uint32_t b, uint32_t c) {
+inline uint32_t SHA256::majority(uint32_t a, uint32_t b, uint32_t c) {
 	return (a & (b | c)) | (b & c);
 }
 
-uint32_t SHA256::sig0(uint32_t x) {
+inline uint32_t SHA256::sig0(uint32_t x) {
 	return SHA256::rotr(x, 7) ^ SHA256::rotr(x, 18) ^ (x >> 3);
 }
 
-uint32_t SHA256::sig1(uint32_t x) {
+inline uint32_t SHA256::sig1(uint32_t x) {
 	return SHA256::rotr(x, 17) ^ SHA256::rotr(x, 19) ^ (x >> 10);
 }
 
-void SHA256::transform() {
-	uint32_t maj, xorA, ch, xorE, sum, newA, newE, m[64];
-	uint32_t state[8];
+inline void SHA256::compressScalar(uint32_t * hash, const uint8_t * blocks,
+                                   size_t count) {
+	for (; count > 0 ; count--, blocks += 64) {
+		uint32_t maj, xorA, ch, xorE, sum, newA, newE, m[64];
+		uint32_t state[8];
 
-	for (uint8_t i = 0, j = 0; i < 16; i++, j += 4) { // Split data in 32 bit blocks for the 16 first words
-		m[i] = (m_data[j] << 24) | (m_data[j + 1] << 16) | (m_data[j + 2] << 8) | (m_data[j + 3]);
-	}
+		for (uint8_t i = 0, j = 0; i < 16; i++, j += 4) { // Split data in 32 bit blocks for the 16 first words
+			m[i] = (blocks[j] << 24) | (blocks[j + 1] << 16) | (blocks[j + 2] << 8) | (blocks[j + 3]);
+		}
 
-	for (uint8_t k = 16 ; k < 64; k++) { // Remaining 48 blocks
-		m[k] = SHA256::sig1(m[k - 2]) + m[k - 7] + SHA256::sig0(m[k - 15]) + m[k - 16];
-	}
+		for (uint8_t k = 16 ; k < 64; k++) { // Remaining 48 blocks
+			m[k] = SHA256::sig1(m[k - 2]) + m[k - 7] + SHA256::sig0(m[k - 15]) + m[k - 16];
+		}
 
-	for(uint8_t i = 0 ; i < 8 ; i++) {
-		state[i] = m_state[i];
-	}
+		for(uint8_t i = 0 ; i < 8 ; i++) {
+			state[i] = hash[i];
+		}
+
+		for (uint8_t i = 0; i < 64; i++) {
+			maj   = SHA256::majority(state[0], state[1], state[2]);
+			xorA  = SHA256::rotr(state[0], 2) ^ SHA256::rotr(state[0], 13) ^ SHA256::rotr(state[0], 22);
+
+			ch = choose(state[4], state[5], state[6]);
 
-	for (uint8_t i = 0; i < 64; i++) {
-		maj   = SHA256::majority(state[0], state[1], state[2]);
-		xorA  = SHA256::rotr(state[0], 2) ^ SHA256::rotr(state[0], 13) ^ SHA256::rotr(state[0], 22);
+			xorE  = SHA256::rotr(state[4], 6) ^ SHA256::rotr(state[4], 11) ^ SHA256::rotr(state[4], 25);
 
-		ch = choose(state[4], state[5], state[6]);
+			sum  = m[i] + K[i] + state[7] + ch + xorE;
+			newA = xorA + maj + sum;
+			newE = state[3] + sum;
 
-		xorE  = SHA256::rotr(state[4], 6) ^ SHA256::rotr(state[4], 11) ^ SHA256::rotr(state[4], 25);
+			state[7] = state[6];
+			state[6] = state[5];
+			state[5] = state[4];
+			state[4] = newE;
+			state[3] = state[2];
+			state[2] = state[1];
+			state[1] = state[0];
+			state[0] = newA;
+		}
 
-		sum  = m[i] + K[i] + state[7] + ch + xorE;
-		newA = xorA + maj + sum;
-		newE = state[3] + sum;
+		for(uint8_t i = 0 ; i < 8 ; i++) {
+			hash[i] += state[i];
+		}
+	}
+}
 
-		state[7] = state[6];
-		state[6] = state[5];
-		state[5] = state[4];
-		state[4] = newE;
-		state[3] = state[2];
-		state[2] = state[1];
-		state[1] = state[0];
-		state[0] = newA;
+#if defined(__x86_64__) || defined(__i386__)
+namespace sha256_detail {
+
+// Rounds 4g to 4g+3 on SHA-NI. The message schedule for later groups is
+// computed as it goes: msg1 three groups ahead and msg2 one ahead, each
+// only while those groups exist.
+template <int g>
+__attribute__((always_inline, target("sha,sse4.1")))
+inline void rounds(__m128i & abef, __m128i & cdgh, __m128i (&msg)[4],
+                   const uint32_t * k) {
+	__m128i m = _mm_add_epi32(msg[g % 4], _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(k + 4 * g)));
+	cdgh = _mm_sha256rnds2_epu32(cdgh, abef, m);
+	if constexpr (g >= 3 && g <= 14) {
+		__m128i & next = msg[(g + 1) % 4];
+		next = _mm_add_epi32(next,
+			_mm_alignr_epi8(msg[g % 4], msg[(g + 3) % 4], 4));
+		next = _mm_sha256msg2_epu32(next, msg[g % 4]);
+	}
+	abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(m, 0x0e));
+	if constexpr (g >= 1 && g <= 12) {
+		msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], msg[g % 4]);
 	}
+}
+
+template <int... G>
+__attribute__((always_inline, target("sha,sse4.1")))
+inline void allRounds(std::integer_sequence<int, G...>, __m128i & abef,
+                      __m128i & cdgh, __m128i (&msg)[4],
+                      const uint8_t * block, const uint32_t * k) {
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+	                                    0x0405060700010203ULL);
+	// The first four groups also load their message words
+	((G < 4 ? (void) (msg[G % 4] = _mm_shuffle_epi8(
+	              _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+	                  block + (G % 4) * 16)), mask))
+	        : (void) 0,
+	  rounds<G>(abef, cdgh, msg, k)), ...);
+}
+
+}
 
-	for(uint8_t i = 0 ; i < 8 ; i++) {
-		m_state[i] += state[i];
+__attribute__((target("sha,sse4.1")))
+inline void SHA256::compressShaNi(uint32_t * state, const uint8_t * blocks,
+                                  size_t count) {
+	// The instructions keep the state as ABEF and CDGH
+	__m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+	__m128i hgfe = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(state + 4));
+	__m128i cdab = _mm_shuffle_epi32(dcba, 0xb1);
+	__m128i efgh = _mm_shuffle_epi32(hgfe, 0x1b);
+	__m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+	__m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+	for (; count > 0 ; count--, blocks += 64) {
+		__m128i abefSaved = abef, cdghSaved = cdgh;
+		__m128i msg[4];
+		sha256_detail::allRounds(std::make_integer_sequence<int, 16>{},
+		                         abef, cdgh, msg, blocks, K.data());
+		abef = _mm_add_epi32(abef, abefSaved);
+		cdgh = _mm_add_epi32(cdgh, cdghSaved);
 	}
+
+	__m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+	__m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state),
+	                 _mm_blend_epi16(feba, dchg, 0xf0));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4),
+	                 _mm_alignr_epi8(dchg, feba, 8));
 }
+#endif
 
-void SHA256::pad() {
+inline void SHA256::pad() {
 
 	uint64_t i = m_blocklen;
 	uint8_t end = m_blocklen < 56 ? 56 : 64;
@@ -169,7 +310,7 @@ void SHA256::pad() {
 	}
 
 	if(m_blocklen >= 56) {
-		transform();
+		m_compress(m_state, m_data, 1);
 		memset(m_data, 0, 56);
 	}
 
@@ -183,10 +324,10 @@ void SHA256::pad() {
 	m_data[58] = m_bitlen >> 40;
 	m_data[57] = m_bitlen >> 48;
 	m_data[56] = m_bitlen >> 56;
-	transform();
+	m_compress(m_state, m_data, 1);
 }
 
-void SHA256::revert(std::array<uint8_t, 32> & hash) {
+inline void SHA256::revert(std::array<uint8_t, 32> & hash) {
 	// SHA uses big endian byte ordering
 	// Revert all bytes
 	for (uint8_t i = 0 ; i < 4 ; i++) {
@@ -196,15 +337,19 @@ void SHA256::revert(std::array<uint8_t, 32> & hash) {
 	}
 }
 
-std::string SHA256::toString(const std::array<uint8_t, 32> & digest) {
-	std::stringstream s;
-	s << std::setfill('0') << std::hex;
-
-	for(uint8_t i = 0 ; i < 32 ; i++) {
-		s << std::setw(2) << (unsigned int) digest[i];
+inline SHA256::Hex SHA256::toHex(const std::array<uint8_t, 32> & digest) {
+	static constexpr char digits[] = "0123456789abcdef";
+	Hex hex;
+	for (uint8_t i = 0 ; i < 32 ; i++) {
+		hex[2 * i] = digits[digest[i] >> 4];
+		hex[2 * i + 1] = digits[digest[i] & 0x0f];
 	}
+	hex[64] = '\0';
+	return hex;
+}
 
-	return s.str();
+inline std::string SHA256::toString(const std::array<uint8_t, 32> & digest) {
+	Hex hex = toHex(digest);
+	return std::string(hex.data(), 64);
 }
 #endif
-
@@ -1,6 +1,7 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 #include <string>
+#include <string_view>
 #include <bitset>
 #include "sha256.h"
 
@@ -26,20 +27,10 @@ std::string binaryToHex(std::string binary){
     return hex;
 }
 
-std::string xorDistance(std::string hex1, std::string hex2){
-    std::string bin1 = hexToBinary(hex1);
-    std::string bin2 = hexToBinary(hex2);
-    std::string result = "";
-    for(size_t i = 0; i < bin1.size(); i++){
-        result.push_back((bin1[i]!= bin2[i])+'0');
-    }
-    return binaryToHex(result);
-}
-
 
-std::string getSha256(std::string data){
+std::string getSha256(std::string_view data){
     SHA256 sha;
-    sha.update(data);
+    sha.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
     auto hash = sha.digest();
     return SHA256::toString(hash);
 }
@@ -2,7 +2,7 @@
 
 void DHT::run() {
   std::thread(&UDPNetwork::listenForResponses, networkLayer.get(),
-              std::ref(routingTable), std::ref(dataStore))
+              std::ref(*routingTable), std::ref(dataStore))
       .detach();
 
   // TODO: Implement peer connection and data exchange logic here
@@ -15,13 +15,13 @@ void DHT::run() {
 
 void DHT::refreshRoutingTable() {
   // Iterate through all buckets in the routing table
-  for (int i = 0; i < 160; ++i) {
-    std::vector<Node> nodes = routingTable.getNodesInBucket(i);
+  for (int i = 0; i < routingTable->getBucketCount(); ++i) {
+    std::vector<Node> nodes = routingTable->getNodesInBucket(i);
     for (const Node& node : nodes) {
       // Check if the node is still active
       if (!networkLayer->sendPing(node)) {
         // If not active, remove it from the routing table
-        routingTable.removeNode(node);
+        routingTable->removeNode(node);
       }
     }
   }
@@ -34,7 +34,8 @@ std::optional<std::string> DHT::findValue(const std::string& key) {
   }
 
   // Find the closest nodes to the key
-  std::vector<Node> closestNodes = routingTable.findClosestNodes(key);
+  std::vector<Node> closestNodes =
+      routingTable->findClosestNodes(NodeId::hash(key));
 
   // Query the closest nodes for the value
   for (const Node& node : closestNodes) {
@@ -1,10 +1,97 @@
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <string>
 #include <thread>
+#include <vector>
 #include "CLI11.hpp"
 #include "Kademlia.hpp"
+#include "MappedFile.hpp"
+#include "PieceRecheck.hpp"
+#include "TorrentCreator.hpp"
+#include "TorrentLoader.hpp"
+
+// `create <path> -o <file>` writes a torrent for a file or directory
+static int createTorrent(int argc, char** argv) {
+  CLI::App app{"Create a .torrent file"};
+  std::string source, output, announce, comment;
+  uint32_t piece_length = 0;
+  app.add_option("path", source, "File or directory to share")->required();
+  app.add_option("-o,--output", output, "Torrent file to write")->required();
+  app.add_option("-a,--announce", announce, "Tracker announce URL");
+  app.add_option("--comment", comment, "Comment stored in the torrent");
+  app.add_option("-l,--piece-length", piece_length,
+                 "Piece length in bytes (default: chosen from the size)");
+  CLI11_PARSE(app, argc, argv);
+
+  ThreadPool pool;
+  TorrentCreator creator(pool);
+  creator.setPieceLength(piece_length);
+  creator.setAnnounce(announce);
+  creator.setComment(comment);
+  creator.onProgress([](const TorrentCreator::Progress& progress) {
+    std::cout << "\rHashed " << (progress.bytesHashed >> 20) << "/"
+              << (progress.totalBytes >> 20) << " MiB, " << std::fixed
+              << std::setprecision(1) << progress.bytesPerSecond() / (1 << 20)
+              << " MiB/s" << std::flush;
+  });
+  try {
+    std::string torrent = creator.create(source);
+    std::ofstream out(output, std::ios::binary);
+    if (!out.write(torrent.data(), torrent.size()))
+      throw std::runtime_error("Cannot write " + output);
+  } catch (const std::exception& e) {
+    std::cerr << "\nCannot create torrent: " << e.what() << std::endl;
+    return 1;
+  }
+  std::cout << "\nWrote " << output << std::endl;
+  return 0;
+}
+
+// `recheck <torrent> <directory>` reports which pieces are on disk
+static int recheckTorrent(int argc, char** argv) {
+  CLI::App app{"Check downloaded data against a .torrent file"};
+  std::string torrent_path, directory;
+  size_t io_threads = 2, memory_mib = 256;
+  app.add_option("torrent", torrent_path, "Torrent file")->required();
+  app.add_option("directory", directory,
+                 "Directory holding the torrent's data")
+      ->required();
+  app.add_option("--io-threads", io_threads, "Threads reading from disk");
+  app.add_option("--memory", memory_mib, "Read buffer limit in MiB");
+  CLI11_PARSE(app, argc, argv);
+
+  try {
+    MappedFile file(torrent_path);
+    TorrentMetainfo meta = TorrentMetainfo::parse(file.view());
+    ThreadPool pool;
+    PieceRecheck recheck(meta, pool);
+    recheck.setIoThreads(io_threads);
+    recheck.setMemoryLimit(memory_mib << 20);
+    recheck.onProgress([](const PieceRecheck::Progress& progress) {
+      std::cout << "\rChecked " << progress.piecesChecked << "/"
+                << progress.pieceCount << " pieces, " << std::fixed
+                << std::setprecision(1)
+                << progress.bytesPerSecond() / (1 << 20) << " MiB/s"
+                << std::flush;
+    });
+    Bitfield complete = recheck.check(directory);
+    std::cout << "\n" << complete.countSet() << " of " << complete.size()
+              << " pieces complete" << std::endl;
+    return complete.all() ? 0 : 2;
+  } catch (const std::exception& e) {
+    std::cerr << "\nCannot recheck torrent: " << e.what() << std::endl;
+    return 1;
+  }
+}
 
 int main(int argc, char** argv) {
+  // Torrent creation and rechecking run without starting a node
+  if (argc > 1 && std::string(argv[1]) == "create")
+    return createTorrent(argc - 1, argv + 1);
+  if (argc > 1 && std::string(argv[1]) == "recheck")
+    return recheckTorrent(argc - 1, argv + 1);
+
   CLI::App app{"Kademlia Distributed Hash Table"};
 
   // Define command line options
@@ -23,10 +110,51 @@ int main(int argc, char** argv) {
   bootstrap_option->needs(
       app.get_option("-B,--bootstrap-port")->required(true));
 
+  std::string torrent_dir;
+  app.add_option("-t,--torrents", torrent_dir,
+                 "Directory of .torrent files to load at startup");
+  std::string cache_path;
+  app.add_option("-c,--cache", cache_path,
+                 "Metainfo cache file that speeds up loading --torrents");
+  bool bucket_tree = false;
+  app.add_flag("--bucket-tree", bucket_tree,
+               "Use a routing table that splits buckets near our ID");
+  int wide_buckets = 0;
+  app.add_option("--wide-buckets", wide_buckets,
+                 "Buckets far from our ID that hold more nodes")
+      ->check(CLI::Range(0, BucketTreeRoutingTable::maxWideBuckets))
+      ->needs(app.get_option("--bucket-tree"));
+
   CLI11_PARSE(app, argc, argv);
 
+  // Check the torrent directory, and bring the cache up to date for the
+  // next start, before joining the network. Nothing serves the torrents
+  // yet, so only the counts are kept.
+  if (!torrent_dir.empty()) {
+    ThreadPool pool;
+    TorrentLoader loader(pool);
+    if (!cache_path.empty()) loader.useCache(cache_path);
+    loader.onError([](const LoadError& error) {
+      std::cerr << "\nSkipping " << error.path << ": " << error.message
+                << std::endl;
+    });
+    loader.onProgress([](const TorrentLoader::Progress& progress) {
+      std::cout << "\rLoaded " << progress.loaded + progress.failed << "/"
+                << progress.total << " torrents" << std::flush;
+    });
+    try {
+      TorrentLoader::Progress progress = loader.load(torrent_dir);
+      std::cout << "\rLoaded " << progress.loaded << " torrents ("
+                << progress.cached << " from cache, " << progress.failed
+                << " failed)" << std::endl;
+    } catch (const std::exception& e) {
+      std::cerr << "Cannot load torrents: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
   // Create a DHT node
-  DHT dht(port);
+  DHT dht(port, bucket_tree, wide_buckets);
 
   // Bootstrap the node if a bootstrap IP is provided
   if (!bootstrap_ip.empty()) {
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/MerkleTree.hpp"
+
+using Hash = MerkleTree::Hash;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+// Reference: pad the leaves with zero hashes to a power of two and fold
+static std::vector<std::vector<Hash>> fullTree(std::vector<Hash> leaves) {
+  size_t width = 1;
+  while (width < leaves.size()) width *= 2;
+  leaves.resize(width, Hash{});
+  std::vector<std::vector<Hash>> layers{leaves};
+  while (layers.back().size() > 1) {
+    std::vector<Hash> above;
+    for (size_t i = 0; i < layers.back().size(); i += 2) {
+      above.push_back(
+          MerkleTree::combine(layers.back()[i], layers.back()[i + 1]));
+    }
+    layers.push_back(above);
+  }
+  return layers;
+}
+
+int main() {
+  for (size_t count = 1; count <= 13; count++) {
+    std::vector<Hash> leaves;
+    for (size_t i = 0; i < count; i++) {
+      leaves.push_back(MerkleTree::hashBlock(std::string(i + 1, 'x')));
+    }
+    auto reference = fullTree(leaves);
+    MerkleTree tree(leaves);
+    std::string name = std::to_string(count) + " leaves";
+    check(tree.root() == reference.back()[0], "root of " + name);
+
+    bool proofs = true;
+    for (size_t i = 0; i < count; i++) {
+      proofs = proofs &&
+               MerkleTree::verify(leaves[i], i, tree.proof(i), tree.root()) &&
+               !MerkleTree::verify(leaves[i], i ^ 1, tree.proof(i),
+                                   tree.root());
+    }
+    check(proofs, "proofs of " + name);
+
+    for (size_t width : {1, 2, 4, 8}) {
+      std::vector<Hash> layer = tree.pieceLayer(width);
+      size_t height = MerkleTree::log2(width);
+      bool same = layer.size() == (count + width - 1) / width;
+      for (size_t i = 0; same && i < layer.size(); i++) {
+        if (height < reference.size()) {
+          same = layer[i] == reference[height][i];
+        } else {
+          same = layer[i] == MerkleTree::subtreeRoot(leaves.data(), count,
+                                                     width);
+        }
+        size_t first = i * width;
+        size_t blocks = std::min(width, count - first);
+        same = same && layer[i] == MerkleTree::subtreeRoot(
+                                       leaves.data() + first, blocks, width);
+      }
+      check(same, "piece layer " + std::to_string(width) + " of " + name);
+      if (width <= count) {
+        check(MerkleTree::rootFromLayer(layer, height) == tree.root(),
+              "root from layer " + std::to_string(width) + " of " + name);
+      }
+    }
+  }
+
+  // Blocks of a buffer, the last one short
+  std::string data(3 * MerkleTree::blockSize + 100, 'd');
+  MerkleTree tree = MerkleTree::fromData(data);
+  check(tree.leafCount() == 4 &&
+            tree.proof(3).size() == 2 &&
+            MerkleTree::verify(MerkleTree::hashBlock(data.substr(
+                                   3 * MerkleTree::blockSize)),
+                               3, tree.proof(3), tree.root()),
+        "tree from data");
+  check(MerkleTree::padHash(1) == MerkleTree::combine(Hash{}, Hash{}),
+        "pad hash");
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../include/MetainfoCache.hpp"
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+static std::string bytes(const MerkleTree::Hash& hash) {
+  return std::string(hash.begin(), hash.end());
+}
+
+static bool same(const TorrentMetainfo& a, const TorrentMetainfo& b) {
+  bool equal =
+      a.getName() == b.getName() && a.getAnnounce() == b.getAnnounce() &&
+      a.getAnnounceList() == b.getAnnounceList() &&
+      a.getComment() == b.getComment() &&
+      a.getCreationDate() == b.getCreationDate() &&
+      a.isMultiFile() == b.isMultiFile() && a.hasV1() == b.hasV1() &&
+      a.hasV2() == b.hasV2() && a.getInfoHash() == b.getInfoHash() &&
+      a.getInfoHashV2() == b.getInfoHashV2() &&
+      a.getPieceLength() == b.getPieceLength() &&
+      a.getPieceCount() == b.getPieceCount() &&
+      a.getTotalLength() == b.getTotalLength() &&
+      std::ranges::equal(a.getPieceHashes(), b.getPieceHashes()) &&
+      a.getFiles().size() == b.getFiles().size();
+  for (size_t i = 0; equal && i < a.getFiles().size(); i++) {
+    const auto& x = a.getFiles()[i];
+    const auto& y = b.getFiles()[i];
+    equal = x.path == y.path && x.length == y.length && x.offset == y.offset &&
+            x.pad == y.pad && x.piecesRoot == y.piecesRoot;
+  }
+  for (size_t piece = 0; equal && piece < a.getPieceCount(); piece++) {
+    auto x = a.getMerklePiece(piece), y = b.getMerklePiece(piece);
+    equal = x.has_value() == y.has_value() &&
+            (!x || (x->root == y->root && x->blocks == y->blocks &&
+                    x->width == y->width));
+    equal = equal && a.fileRange(piece) == b.fileRange(piece);
+  }
+  return equal;
+}
+
+int main(int argc, char** argv) {
+  std::string path = argc > 1
+                         ? argv[1]
+                         : "torrents/ubuntu-20.04.6-desktop-amd64.iso.torrent";
+  MappedFile file(path);
+  TorrentMetainfo ubuntu = TorrentMetainfo::parse(file.view());
+
+  // A v2 torrent with a piece layer and a pad file
+  using Dict = std::map<BencodeValue::KeyType, BencodeValue>;
+  std::string a(70000, 'a'), b(10, 'b');
+  MerkleTree treeA = MerkleTree::fromData(a), treeB = MerkleTree::fromData(b);
+  std::string layer, rootA = bytes(treeA.root());
+  for (const auto& hash : treeA.pieceLayer(1)) layer += bytes(hash);
+  Dict tree = {
+      {"a", Dict{{"", Dict{{"length", int64_t(a.size())},
+                           {"pieces root", rootA}}}}},
+      {"b", Dict{{"", Dict{{"length", int64_t(b.size())},
+                           {"pieces root", bytes(treeB.root())}}}}}};
+  Dict v2Root = {{"info", Dict{{"file tree", tree},
+                               {"meta version", int64_t(2)},
+                               {"name", std::string("v2")},
+                               {"piece length", int64_t(16384)}}},
+                 {"piece layers", Dict{{rootA, layer}}}};
+  TorrentMetainfo v2 = TorrentMetainfo::parse(BencodeValue(v2Root).toString());
+
+  fs::path dir = fs::temp_directory_path() / "test_MetainfoCache";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  std::string cachePath = (dir / "metainfo.cache").string();
+  MetainfoCache::Source ubuntuSource{path, file.size(), 1234};
+  MetainfoCache::Source v2Source{"v2.torrent", 99, 5678};
+  std::string records[] = {MetainfoCache::makeRecord(ubuntu, ubuntuSource),
+                           MetainfoCache::makeRecord(v2, v2Source)};
+  MetainfoCache::write(cachePath, {records[0], records[1]});
+
+  MetainfoCache cache(cachePath);
+  check(cache.size() == 2, "cache opened");
+  auto entry = cache.find(ubuntuSource);
+  check(entry && same(cache.load(*entry), ubuntu), "v1 round trip");
+  entry = cache.find(v2Source);
+  check(entry && same(cache.load(*entry), v2), "v2 round trip");
+  check(cache.find(v2.getInfoHashV2()) == entry, "find by info-hash");
+
+  // Piece hashes are read in place, and outlive the cache object
+  TorrentMetainfo restored;
+  {
+    MetainfoCache scoped(cachePath);
+    size_t at = *scoped.find(ubuntuSource);
+    restored = scoped.load(at);
+    std::string_view record = scoped.record(at);
+    const char* hashes =
+        reinterpret_cast<const char*>(restored.getPieceHashes().data());
+    check(hashes >= record.data() &&
+              hashes + restored.getPieceCount() * 20 <=
+                  record.data() + record.size(),
+          "piece hashes viewed in the mapping");
+  }
+  check(same(restored, ubuntu), "loaded metainfo keeps the mapping");
+
+  MetainfoCache::Source touched = ubuntuSource;
+  touched.mtime++;
+  MetainfoCache::Source renamed = ubuntuSource;
+  renamed.path += ".old";
+  check(!cache.find(touched) && !cache.find(renamed), "stale entries");
+
+  // Damage is detected per record or for the whole file
+  std::string written;
+  {
+    std::ifstream in(cachePath, std::ios::binary);
+    written.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  auto damaged = [&](size_t at) {
+    std::string copy = written;
+    copy[at] ^= 1;
+    std::ofstream(dir / "damaged.cache", std::ios::binary) << copy;
+    return MetainfoCache((dir / "damaged.cache").string());
+  };
+  MetainfoCache badPath = damaged(written.find(path));
+  check(badPath.size() == 2 && !badPath.find(ubuntuSource) &&
+            badPath.find(v2Source),
+        "damaged record rejected");
+
+  // Damaged piece hashes are found on first use, not on lookup
+  const auto& firstHash = ubuntu.getPieceHash(0);
+  MetainfoCache hashed = damaged(
+      written.find(std::string_view(reinterpret_cast<const char*>(
+                                        firstHash.data()),
+                                    firstHash.size())));
+  entry = hashed.find(ubuntuSource);
+  bool threw = false;
+  if (entry) {
+    TorrentMetainfo meta = hashed.load(*entry);
+    try {
+      meta.getPieceHash(1);
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+  }
+  check(threw, "damaged piece hashes rejected on use");
+  check(damaged(40).size() == 0 && damaged(9).size() == 0,
+        "damaged index rejected");
+  check(MetainfoCache((dir / "missing").string()).size() == 0,
+        "missing cache");
+  fs::remove_all(dir);
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
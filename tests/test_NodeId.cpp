@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/dht/NodeId.hpp"
+#include "../include/dht/FlatRoutingTable.hpp"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+static NodeId randomId(std::mt19937& rng) {
+  NodeId::Bytes bytes;
+  for (auto& byte : bytes) byte = static_cast<uint8_t>(rng());
+  return NodeId::fromBytes(bytes);
+}
+
+int main() {
+  std::string hex = "0123456789abcdef0123456789ABCDEF01234567";
+  NodeId id = NodeId::fromHex(hex);
+  check(id.getWords()[0] == 0x01234567 && id.getWords()[4] == 0x01234567,
+        "hex words");
+  std::string lower = hex;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  check(id.toHex() == lower, "hex round trip");
+  check(NodeId::fromBytes(id.toBytes()) == id, "bytes round trip");
+  check(NodeId::hash("abc").toHex() ==
+            "a9993e364706816aba3e25717850c26c9cd0d89d",
+        "SHA-1 of a key");
+  for (const std::string& bad : std::vector<std::string>{
+           "", "0123", hex + "0", "g" + hex.substr(1)}) {
+    bool threw = false;
+    try {
+      NodeId::fromHex(bad);
+    } catch (const std::invalid_argument&) {
+      threw = true;
+    }
+    check(threw, "rejects \"" + bad + "\"");
+  }
+
+  NodeId zero;
+  NodeId top = NodeId::fromHex("8000000000000000000000000000000000000000");
+  NodeId low = NodeId::fromHex("0000000000000000000000000000000000000001");
+  check(zero.sharedPrefix(top) == 0 && zero.sharedPrefix(low) == 159 &&
+            zero.sharedPrefix(zero) == NodeId::bits,
+        "shared prefix");
+  check((top ^ low).toHex() == "8000000000000000000000000000000000000001",
+        "xor");
+
+  // compareDistance orders like comparing the XOR distances themselves
+  std::mt19937 rng(1);
+  bool agrees = true;
+  for (int i = 0; i < 10000; i++) {
+    NodeId a = randomId(rng), b = randomId(rng), target = randomId(rng);
+    if (i % 3 == 0) b = NodeId::fromBytes(a.toBytes());
+    if (i % 5 == 0) {
+      // Share a long prefix so later words decide
+      auto words = a.getWords();
+      words[4] ^= 1u << (i % 32);
+      b = NodeId(words);
+    }
+    agrees = agrees && NodeId::compareDistance(a, b, target) ==
+                           ((a ^ target) <=> (b ^ target));
+  }
+  check(agrees, "distance ordering");
+
+  // The routing table returns the k closest nodes in order
+  FlatRoutingTable table(Node(zero, "127.0.0.1", 6881));
+  std::vector<Node> nodes;
+  for (int i = 0; i < 200; i++) {
+    nodes.emplace_back(randomId(rng), "10.0.0.1", static_cast<uint16_t>(i));
+    table.addNode(nodes.back());
+  }
+  NodeId target = randomId(rng);
+  std::vector<Node> closest = table.findClosestNodes(target);
+  std::vector<NodeId> distances;
+  for (const Node& node : closest) distances.push_back(node.getId() ^ target);
+  check(!closest.empty() && closest.size() <= 20 &&
+            std::is_sorted(distances.begin(), distances.end()),
+        "closest nodes sorted by distance");
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
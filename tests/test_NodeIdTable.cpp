@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/dht/NodeIdTable.hpp"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+static NodeId randomId(std::mt19937& rng) {
+  NodeId::Bytes bytes;
+  for (auto& byte : bytes) byte = static_cast<uint8_t>(rng());
+  return NodeId::fromBytes(bytes);
+}
+
+int main() {
+  std::mt19937 rng(3);
+  std::vector<NodeId> ids;
+  for (int i = 0; i < 1000; i++) ids.push_back(randomId(rng));
+  // Some IDs share their top 64 bits, so the low words have to decide
+  for (int i = 0; i < 50; i++) {
+    auto words = ids[i].getWords();
+    words[3] ^= rng();
+    ids.push_back(NodeId(words));
+  }
+  NodeIdTable table;
+  for (const NodeId& id : ids) table.add(id);
+  bool stored = table.size() == ids.size();
+  for (size_t i = 0; i < ids.size(); i++) {
+    stored = stored && table.get(i) == ids[i];
+  }
+  check(stored, "round trip");
+
+  // Odd sizes exercise the scalar tail after the vector loop
+  for (size_t size : {0, 1, 3, 7, 1050}) {
+    NodeIdTable part;
+    for (size_t i = 0; i < size; i++) part.add(ids[i]);
+    NodeId target = randomId(rng);
+    std::vector<uint64_t> keys(size);
+    part.distanceKeys(target, keys.data());
+    bool same = true;
+    for (size_t i = 0; i < size; i++) {
+      NodeId distance = ids[i] ^ target;
+      const auto& d = distance.getWords();
+      same = same && keys[i] == (uint64_t{d[0]} << 32 | d[1]);
+    }
+    check(same, "keys for " + std::to_string(size) + " IDs");
+  }
+
+  for (int round = 0; round < 20; round++) {
+    NodeId target = round == 0 ? ids[7] : randomId(rng);
+    if (round == 1) {
+      // Share the top 64 bits with some of the table
+      auto words = ids[3].getWords();
+      words[4] ^= 1;
+      target = NodeId(words);
+    }
+    std::vector<size_t> expected(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) expected[i] = i;
+    std::sort(expected.begin(), expected.end(), [&](size_t a, size_t b) {
+      auto order = NodeId::compareDistance(ids[a], ids[b], target);
+      return order != 0 ? order < 0 : a < b;
+    });
+    for (size_t k : {1, 8, 20, 2000}) {
+      std::vector<size_t> got = table.closest(target, k);
+      size_t n = std::min(k, ids.size());
+      check(got == std::vector<size_t>(expected.begin(), expected.begin() + n),
+            "closest " + std::to_string(k) + " in round " +
+                std::to_string(round));
+    }
+  }
+  check(NodeIdTable().closest(ids[0], 8).empty(), "empty table");
+  check(table.closest(ids[0], 0).empty(), "no nodes asked for");
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
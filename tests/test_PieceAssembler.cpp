@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/PieceAssembler.hpp"
+#include "../include/TorrentCreator.hpp"
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+static std::string pattern(size_t size, unsigned seed) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<char>(seed >> 16);
+  }
+  return data;
+}
+
+// Feed piece `piece` of `content` in the order of `blocks`; the status
+// after the last block
+static PieceAssembler::Status feed(PieceAssembler& assembler,
+                                   const TorrentMetainfo& meta,
+                                   const std::string& content, size_t piece,
+                                   const std::vector<size_t>& blocks) {
+  uint32_t size = meta.getPieceSize(piece);
+  uint64_t begin = uint64_t{piece} * meta.getPieceLength();
+  auto status = PieceAssembler::Status::Incomplete;
+  for (size_t block : blocks) {
+    uint32_t offset = static_cast<uint32_t>(block * MerkleTree::blockSize);
+    size_t length = std::min<size_t>(MerkleTree::blockSize, size - offset);
+    std::string_view data(content.data() + begin + offset, length);
+    status = assembler.addBlock(piece, offset, data);
+  }
+  return status;
+}
+
+int main() {
+  fs::path dir = fs::temp_directory_path() / "test_PieceAssembler";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "data");
+  std::vector<std::pair<std::string, std::string>> entries = {
+      {"a.bin", pattern(150000, 1)},  // Ends mid-block, then padding
+      {"b.bin", pattern(20000, 2)},   // Smaller than a piece
+      {"c.bin", pattern(262144, 3)},
+  };
+  for (const auto& [path, data] : entries) {
+    std::ofstream(dir / "data" / path, std::ios::binary) << data;
+  }
+
+  ThreadPool pool(2);
+  std::mt19937 rng(7);
+  for (bool hybrid : {true, false}) {
+    std::string kind = hybrid ? "hybrid" : "v2";
+    TorrentCreator creator(pool);
+    creator.setPieceLength(65536);
+    creator.setHybrid(hybrid);
+    TorrentMetainfo meta =
+        TorrentMetainfo::parse(creator.create((dir / "data").string()));
+
+    // The torrent's byte stream, pad files included
+    std::string content;
+    for (const auto& file : meta.getFiles()) {
+      if (file.pad) {
+        content.append(file.length, '\0');
+        continue;
+      }
+      for (const auto& [path, data] : entries) {
+        if (file.path == "data/" + path) content += data;
+      }
+    }
+
+    PieceAssembler assembler(meta);
+    bool inOrder = true, reversed = true, shuffled = true;
+    size_t peak = 0;
+    for (size_t piece = 0; piece < meta.getPieceCount(); piece++) {
+      size_t blocks = (meta.getPieceSize(piece) + MerkleTree::blockSize - 1) /
+                      MerkleTree::blockSize;
+      std::vector<size_t> order(blocks);
+      for (size_t i = 0; i < blocks; i++) order[i] = i;
+      inOrder = inOrder && feed(assembler, meta, content, piece, order) ==
+                               PieceAssembler::Status::Valid;
+      inOrder = inOrder && assembler.bufferedBytes() == 0;
+
+      std::reverse(order.begin(), order.end());
+      order.pop_back();
+      feed(assembler, meta, content, piece, order);
+      peak = std::max(peak, assembler.bufferedBytes());
+      reversed = reversed && feed(assembler, meta, content, piece, {0}) ==
+                                 PieceAssembler::Status::Valid;
+
+      // Repeats are ignored
+      order.push_back(0);
+      std::shuffle(order.begin(), order.end(), rng);
+      if (blocks > 1) order.insert(order.begin() + 1, order.front());
+      shuffled = shuffled && feed(assembler, meta, content, piece, order) ==
+                                 PieceAssembler::Status::Valid;
+    }
+    check(inOrder, kind + ": in order, nothing buffered");
+    check(reversed && peak == (hybrid ? 3 * MerkleTree::blockSize : 0),
+          kind + ": reversed, buffered only for SHA-1");
+    check(shuffled, kind + ": shuffled with a repeat");
+    check(assembler.activePieces() == 0 && assembler.bufferedBytes() == 0,
+          kind + ": nothing left over");
+
+    // A damaged block fails the piece, which can then be fetched again
+    std::string damaged = content;
+    damaged[65536 + 40000] ^= 1;
+    check(feed(assembler, meta, damaged, 1, {0, 1, 2, 3}) ==
+              PieceAssembler::Status::Invalid,
+          kind + ": damaged piece");
+    check(feed(assembler, meta, content, 1, {3, 2, 1, 0}) ==
+              PieceAssembler::Status::Valid,
+          kind + ": piece fetched again");
+
+    feed(assembler, meta, content, 2, {2, 3});
+    check(assembler.activePieces() == 1, kind + ": partial piece");
+    assembler.abandon(2);
+    check(assembler.activePieces() == 0 && assembler.bufferedBytes() == 0,
+          kind + ": abandoned piece");
+
+    bool threw = false;
+    try {
+      assembler.addBlock(0, 100, std::string_view(content).substr(0, 16384));
+    } catch (const std::invalid_argument&) {
+      threw = true;
+    }
+    check(threw, kind + ": misaligned block");
+  }
+
+  fs::remove_all(dir);
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/PieceRecheck.hpp"
+#include "../include/TorrentCreator.hpp"
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+static std::string pattern(size_t size, unsigned seed) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<char>(seed >> 16);
+  }
+  return data;
+}
+
+// Pieces spanned by the file at `path`
+static std::pair<size_t, size_t> piecesOf(const TorrentMetainfo& meta,
+                                          const std::string& path) {
+  for (const auto& file : meta.getFiles()) {
+    if (file.path != path) continue;
+    size_t first = file.offset / meta.getPieceLength();
+    size_t last = (file.offset + file.length + meta.getPieceLength() - 1) /
+                  meta.getPieceLength();
+    return {first, last};
+  }
+  return {0, 0};
+}
+
+int main() {
+  Bitfield bits(10);
+  bits.set(0);
+  bits.set(9);
+  bits.set(3);
+  bits.set(3, false);
+  check(bits.get(0) && !bits.get(3) && bits.get(9) && bits.countSet() == 2 &&
+            bits.bytes() == std::vector<uint8_t>{0x80, 0x40},
+        "bitfield wire order");
+  bool threw = false;
+  try {
+    bits.get(10);
+  } catch (const std::out_of_range&) {
+    threw = true;
+  }
+  check(threw, "bitfield bounds");
+
+  fs::path dir = fs::temp_directory_path() / "test_PieceRecheck";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "data" / "sub");
+  std::vector<std::pair<std::string, std::string>> entries = {
+      {"a.bin", pattern(100000, 1)},
+      {"sub/b.bin", pattern(5000, 2)},
+      {"sub/c.bin", pattern(200000, 3)},
+      {"z.bin", pattern(32768, 4)},
+  };
+  for (const auto& [path, data] : entries) {
+    std::ofstream(dir / "data" / path, std::ios::binary) << data;
+  }
+
+  ThreadPool pool(3);
+  for (bool hybrid : {true, false}) {
+    std::string kind = hybrid ? "hybrid" : "v2";
+    TorrentCreator creator(pool);
+    creator.setPieceLength(16384);
+    creator.setHybrid(hybrid);
+    TorrentMetainfo meta =
+        TorrentMetainfo::parse(creator.create((dir / "data").string()));
+
+    PieceRecheck recheck(meta, pool);
+    std::vector<PieceRecheck::Progress> reports;
+    recheck.onProgress(
+        [&](const PieceRecheck::Progress& p) { reports.push_back(p); });
+    Bitfield complete = recheck.check(dir);
+    check(complete.size() == meta.getPieceCount() && complete.all(),
+          kind + ": intact data passes");
+    check(!reports.empty() &&
+              reports.back().piecesChecked == meta.getPieceCount() &&
+              reports.back().piecesValid == meta.getPieceCount() &&
+              reports.back().bytesChecked == meta.getTotalLength(),
+          kind + ": final progress");
+
+    // Small reads and a memory cap of two spans give the same answer
+    recheck.setReadSize(40000);
+    recheck.setMemoryLimit(65536);
+    recheck.setIoThreads(3);
+    check(recheck.check(dir) == complete, kind + ": capped memory");
+
+    // One damaged byte fails exactly its piece
+    fs::path c = dir / "data" / "sub" / "c.bin";
+    std::string damaged = entries[2].second;
+    damaged[70000] ^= 1;
+    std::ofstream(c, std::ios::binary) << damaged;
+    auto [cFirst, cLast] = piecesOf(meta, "data/sub/c.bin");
+    Bitfield result = recheck.check(dir);
+    size_t bad = cFirst + 70000 / 16384;
+    check(!result.get(bad) && result.countSet() == meta.getPieceCount() - 1,
+          kind + ": damaged piece");
+    std::ofstream(c, std::ios::binary) << entries[2].second;
+
+    // A missing file fails its pieces and nothing else; a short one fails
+    // its tail
+    fs::rename(c, dir / "c.bin");
+    result = recheck.check(dir);
+    bool ok = result.countSet() == meta.getPieceCount() - (cLast - cFirst);
+    for (size_t p = cFirst; p < cLast; p++) ok = ok && !result.get(p);
+    check(ok, kind + ": missing file");
+    fs::rename(dir / "c.bin", c);
+    fs::resize_file(dir / "data" / "a.bin", 50000);
+    auto [aFirst, aLast] = piecesOf(meta, "data/a.bin");
+    result = recheck.check(dir);
+    ok = result.countSet() == meta.getPieceCount() - (aLast - 3);
+    for (size_t p = aFirst; p < aLast; p++) ok = ok && result.get(p) == (p < 3);
+    check(ok, kind + ": truncated file");
+    std::ofstream(dir / "data" / "a.bin", std::ios::binary)
+        << entries[0].second;
+  }
+
+  fs::remove_all(dir);
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
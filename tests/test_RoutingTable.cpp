@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/dht/BucketTreeRoutingTable.hpp"
+#include "../include/dht/FlatRoutingTable.hpp"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+// An ID in bucket 0 relative to the zero ID, numbered by its last word
+static NodeId farId(uint32_t n) { return NodeId({0x80000000, 0, 0, 0, n}); }
+
+static NodeId randomId(std::mt19937& rng) {
+  NodeId::Bytes bytes;
+  for (auto& byte : bytes) byte = static_cast<uint8_t>(rng());
+  return NodeId::fromBytes(bytes);
+}
+
+// `id` with its first `bits` bits replaced by those of `prefix`
+static NodeId withPrefix(const NodeId& id, const NodeId& prefix, int bits) {
+  NodeId::Bytes a = id.toBytes(), b = prefix.toBytes();
+  for (int i = 0; i < bits; i++) {
+    uint8_t mask = static_cast<uint8_t>(0x80 >> (i % 8));
+    a[i / 8] = static_cast<uint8_t>((a[i / 8] & ~mask) | (b[i / 8] & mask));
+  }
+  return NodeId::fromBytes(a);
+}
+
+static std::vector<uint16_t> ports(const std::vector<Node>& nodes) {
+  std::vector<uint16_t> result;
+  for (const Node& node : nodes) result.push_back(node.getPort());
+  return result;
+}
+
+// Bucket bookkeeping, with every node in bucket 0 of the zero ID
+static void checkBuckets(RoutingTable& table, const std::string& name) {
+  for (uint16_t i = 0; i < 3; i++) {
+    table.addNode(Node(farId(i), "10.0.0.1", i));
+  }
+  check(ports(table.getNodesInBucket(0)) == std::vector<uint16_t>{0, 1, 2},
+        name + "least recently seen first");
+
+  // Seeing a node again moves it to the back
+  table.addNode(Node(farId(0), "10.0.0.1", 0));
+  check(ports(table.getNodesInBucket(0)) == std::vector<uint16_t>{1, 2, 0},
+        name + "update moves to the back");
+  table.markResponded(farId(1), std::chrono::milliseconds(40));
+  check(ports(table.getNodesInBucket(0)) == std::vector<uint16_t>{2, 0, 1} &&
+            table.findContact(farId(1))->rttMs == 40,
+        name + "reply moves to the back");
+
+  // Removal keeps the order of the rest
+  table.removeNode(Node(farId(2), "10.0.0.1", 2));
+  check(ports(table.getNodesInBucket(0)) == std::vector<uint16_t>{0, 1} &&
+            table.findContact(farId(2)) == nullptr && table.size() == 2,
+        name + "remove");
+  table.removeNode(Node(farId(0), "10.0.0.1", 0));
+  table.addNode(Node(farId(3), "10.0.0.1", 3));
+  check(ports(table.getNodesInBucket(0)) == std::vector<uint16_t>{1, 3},
+        name + "insert after remove");
+
+  // A full bucket keeps its nodes until the oldest one stops answering
+  for (uint16_t i = 4; table.size() < 20; i++) {
+    table.addNode(Node(farId(i), "10.0.0.1", i));
+  }
+  table.addNode(Node(farId(100), "10.0.0.1", 100));
+  check(table.size() == 20 && table.findContact(farId(100)) == nullptr,
+        name + "full bucket rejects");
+  for (int i = 0; i < 3; i++) table.markFailed(farId(1));
+  table.addNode(Node(farId(100), "10.0.0.1", 100));
+  check(table.size() == 20 && table.findContact(farId(1)) == nullptr &&
+            ports(table.getNodesInBucket(0)).back() == 100,
+        name + "failed node replaced");
+  check(table.getNodesInBucket(1).empty(), name + "other buckets empty");
+}
+
+static std::vector<Node> sortedByDistance(std::vector<Node> nodes,
+                                          const NodeId& target,
+                                          size_t count) {
+  std::sort(nodes.begin(), nodes.end(), [&](const Node& a, const Node& b) {
+    return (a.getId() ^ target) < (b.getId() ^ target);
+  });
+  nodes.erase(nodes.begin() + std::min(count, nodes.size()), nodes.end());
+  return nodes;
+}
+
+// Add `offered` to `table`, then compare lookups around `local` with a
+// full sort of the nodes it kept
+static void checkClosest(RoutingTable& table, const NodeId& local,
+                         const std::vector<Node>& offered, std::mt19937& rng,
+                         const std::string& name) {
+  for (const Node& node : offered) table.addNode(node);
+  std::vector<Node> kept;
+  for (int i = 0; i < table.getBucketCount(); i++) {
+    for (const Node& node : table.getNodesInBucket(i)) kept.push_back(node);
+  }
+  check(kept.size() == table.size() && kept.size() > 500,
+        name + "table filled");
+
+  bool exact = true;
+  for (int i = 0; i < 300; i++) {
+    NodeId target =
+        withPrefix(randomId(rng), local, static_cast<int>(rng() % 45));
+    size_t count = i % 3 == 0 ? 20 : 1 + rng() % 60;
+    exact = exact && table.findClosestNodes(target, count) ==
+                         sortedByDistance(kept, target, count);
+  }
+  check(exact, name + "closest nodes are exact");
+}
+
+int main() {
+  check(sizeof(Contact) == 48, "contact size");
+
+  // Addresses survive the packed form
+  for (std::string ip : {"192.168.1.20", "2001:db8::1", "::1"}) {
+    Node node(farId(1), ip, 6881);
+    node.setLastSeen(1700000000);
+    Node back = Contact::fromNode(node).toNode();
+    check(back.getAddress() == ip && back.getPort() == 6881 &&
+              back.getId() == node.getId() &&
+              back.getLastSeen() == 1700000000,
+          "round trip " + ip);
+  }
+  check(Contact::fromNode(Node(farId(1), "10.0.0.1", 1)).isIPv4() &&
+            !Contact::fromNode(Node(farId(1), "::1", 1)).isIPv4(),
+        "address family");
+  bool threw = false;
+  try {
+    Contact::fromNode(Node(farId(1), "example.org", 1));
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  check(threw, "rejects a host name");
+
+  FlatRoutingTable flat(Node(NodeId(), "127.0.0.1", 6881));
+  checkBuckets(flat, "flat: ");
+  BucketTreeRoutingTable tree(Node(NodeId(), "127.0.0.1", 6881));
+  checkBuckets(tree, "tree: ");
+
+  // Closest nodes match a full sort of every node, for targets near and
+  // far from the local ID and for several counts
+  std::mt19937 rng(7);
+  NodeId local = randomId(rng);
+  std::vector<Node> offered;
+  for (int i = 0; i < 3000; i++) {
+    // Spread nodes over many buckets, not just the first few
+    NodeId id = withPrefix(randomId(rng), local, static_cast<int>(rng() % 40));
+    offered.emplace_back(id, "10.0.0.1", static_cast<uint16_t>(i));
+  }
+  FlatRoutingTable flatFull(Node(local, "127.0.0.1", 6881));
+  BucketTreeRoutingTable treeFull(Node(local, "127.0.0.1", 6881));
+  BucketTreeRoutingTable wideFull(Node(local, "127.0.0.1", 6881), 2);
+  BucketTreeRoutingTable oneWide(Node(local, "127.0.0.1", 6881), 1);
+  checkClosest(flatFull, local, offered, rng, "flat: ");
+  checkClosest(treeFull, local, offered, rng, "tree: ");
+  checkClosest(wideFull, local, offered, rng, "wide tree: ");
+  checkClosest(oneWide, local, offered, rng, "one wide tree: ");
+  check(FlatRoutingTable(Node(local, "127.0.0.1", 1))
+                .findClosestNodes(local)
+                .empty() &&
+            BucketTreeRoutingTable(Node(local, "127.0.0.1", 1))
+                .findClosestNodes(local)
+                .empty(),
+        "empty table");
+
+  // The tree keeps every node near the local ID
+  std::vector<Node> nearest = sortedByDistance(offered, local, 20);
+  check(treeFull.findClosestNodes(local) == nearest &&
+            wideFull.findClosestNodes(local) == nearest,
+        "tree keeps the nearest nodes");
+  check(treeFull.getBucketCount() > 1 && treeFull.getBucketCount() < 160,
+        "tree grows with the nodes seen");
+  check(wideFull.getNodesInBucket(0).size() > 20 &&
+            wideFull.getNodesInBucket(1).size() == 40 &&
+            wideFull.getNodesInBucket(2).size() == 20 &&
+            wideFull.size() > treeFull.size(),
+        "wide buckets");
+  bool within = true;
+  for (int i = 0; i < wideFull.getBucketCount(); i++) {
+    within = within && wideFull.getNodesInBucket(i).size() <=
+                           size_t(20 << std::max(2 - i, 0));
+  }
+  check(within, "wide buckets within their limits");
+  check(oneWide.getNodesInBucket(0).size() == 40 &&
+            oneWide.getNodesInBucket(1).size() == 20,
+        "one wide bucket");
+
+  // Splitting moves the nodes sharing one more bit, keeping their order
+  BucketTreeRoutingTable split(Node(NodeId(), "127.0.0.1", 6881));
+  auto nearId = [](uint32_t n) { return NodeId({0x40000000, 0, 0, 0, n}); };
+  for (uint16_t i = 0; i < 20; i++) {
+    split.addNode(Node(i % 2 ? nearId(i) : farId(i), "10.0.0.1", i));
+  }
+  check(split.getBucketCount() == 1, "no split below k");
+  split.addNode(Node(nearId(20), "10.0.0.1", 20));
+  check(split.getBucketCount() == 2 &&
+            ports(split.getNodesInBucket(0)) ==
+                std::vector<uint16_t>{0, 2, 4, 6, 8, 10, 12, 14, 16, 18} &&
+            ports(split.getNodesInBucket(1)) ==
+                std::vector<uint16_t>{1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 20},
+        "split keeps order");
+
+  // Out of a wide bucket, a split cascades and trims every bucket to its
+  // limit, keeping the most recently seen nodes
+  BucketTreeRoutingTable cascade(Node(NodeId(), "127.0.0.1", 6881), 2);
+  for (uint16_t i = 0; i <= 80; i++) {
+    cascade.addNode(Node(nearId(i), "10.0.0.1", i));
+  }
+  std::vector<uint16_t> newest(40);
+  std::iota(newest.begin(), newest.end(), uint16_t(40));
+  check(cascade.getNodesInBucket(0).empty() &&
+            ports(cascade.getNodesInBucket(1)) == newest &&
+            cascade.size() == 40,
+        "cascading split trims to the limit");
+
+  threw = false;
+  try {
+    BucketTreeRoutingTable(Node(local, "127.0.0.1", 1), 3);
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  check(threw, "rejects too many wide buckets");
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/SHA256Batch.hpp"
+#include "../include/sha256.h"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+int main() {
+  // Lengths on both sides of the one- and two-block padding boundaries,
+  // mixed within each group of lanes, and a count that leaves lanes unused
+  std::vector<std::string> inputs;
+  for (size_t length : {0, 1, 3, 55, 56, 63, 64, 65, 119, 120, 128, 1000,
+                        16384, 5, 200, 77, 31}) {
+    std::string input(length, '\0');
+    for (size_t i = 0; i < length; i++) input[i] = char(i * 7 + length);
+    inputs.push_back(input);
+  }
+  std::vector<std::string_view> messages(inputs.begin(), inputs.end());
+  std::vector<SHA256Batch::Digest> expected;
+  for (const std::string& input : inputs) {
+    SHA256 sha;
+    sha.update(input);
+    expected.push_back(sha.digest());
+  }
+
+  using Kernel = SHA256Batch::Kernel;
+  for (Kernel kernel :
+       {Kernel::Scalar, Kernel::SSE2, Kernel::AVX2, Kernel::SHANI}) {
+    if ((kernel == Kernel::AVX2 && !__builtin_cpu_supports("avx2")) ||
+        (kernel == Kernel::SHANI && !SHA256::hardwareAccelerated()))
+      continue;
+    std::vector<SHA256Batch::Digest> out(messages.size());
+    SHA256Batch::hash(messages.data(), messages.size(), out.data(), kernel);
+    check(out == expected, "kernel " + std::to_string(int(kernel)) +
+                               " matches SHA256");
+  }
+  SHA256Batch::Digest abc;
+  std::string_view message = "abc";
+  SHA256Batch::hash(&message, 1, &abc);
+  check(SHA256::toString(abc) ==
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "FIPS vector");
+  SHA256Batch::Digest empty;
+  std::string_view none;  // data() is null
+  SHA256Batch::hash(&none, 1, &empty);
+  check(SHA256::toString(empty) ==
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        "empty message without data");
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
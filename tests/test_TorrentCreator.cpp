@@ -0,0 +1,162 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/TorrentCreator.hpp"
+#include "../include/TorrentMetainfo.hpp"
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+static std::string pattern(size_t size, unsigned seed) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<char>(seed >> 16);
+  }
+  return data;
+}
+
+// Every piece matches its v1 and v2 hashes
+static bool verifies(const TorrentMetainfo& meta, const std::string& data) {
+  for (size_t piece = 0; piece < meta.getPieceCount(); piece++) {
+    uint64_t at = uint64_t{piece} * meta.getPieceLength();
+    if (!meta.verifyPiece(piece, std::string_view(data).substr(
+                                     at, meta.getPieceSize(piece))))
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  fs::path dir = fs::temp_directory_path() / "test_TorrentCreator";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "album" / "disc1");
+  fs::create_directories(dir / "album" / "a");
+
+  // Names chosen so that path order differs from plain string order
+  struct Entry {
+    std::string path;
+    std::string data;
+  };
+  std::vector<Entry> entries = {
+      {"a/cover.jpg", pattern(40000, 1)},
+      {"a.txt", pattern(100, 2)},
+      {"disc1/01.flac", pattern(300000, 3)},
+      {"empty", ""},
+      {"notes", pattern(65536, 4)},
+  };
+  for (const Entry& entry : entries) {
+    std::ofstream(dir / "album" / entry.path, std::ios::binary) << entry.data;
+  }
+
+  ThreadPool pool(3);
+  TorrentCreator creator(pool);
+  creator.setPieceLength(32768);
+  creator.setReadSize(50000);  // Rounded up to 64 KiB
+  creator.setAnnounce("http://tracker.example/announce");
+  creator.setComment("test");
+  std::vector<TorrentCreator::Progress> reports;
+  creator.onProgress(
+      [&](const TorrentCreator::Progress& p) { reports.push_back(p); });
+  TorrentMetainfo meta =
+      TorrentMetainfo::parse(creator.create((dir / "album").string()));
+
+  check(meta.hasV2() && meta.hasV1() && meta.isMultiFile() &&
+            meta.getName() == "album" && meta.getPieceLength() == 32768 &&
+            meta.getAnnounce() == "http://tracker.example/announce" &&
+            meta.getComment() == "test",
+        "multi-file metainfo");
+
+  // Real files appear in file tree order, each aligned to a piece
+  std::string data;
+  std::vector<std::string> order;
+  uint64_t total = 0;
+  for (const auto& file : meta.getFiles()) {
+    if (file.pad) {
+      data.append(file.length, '\0');
+      continue;
+    }
+    std::string path = file.path.substr(file.path.find('/') + 1);
+    order.push_back(path);
+    for (const Entry& entry : entries) {
+      if (entry.path == path) data += entry.data;
+    }
+    total += file.length;
+  }
+  check(order == std::vector<std::string>{"a/cover.jpg", "a.txt",
+                                          "disc1/01.flac", "empty", "notes"},
+        "file order");
+  check(verifies(meta, data), "pieces verify");
+
+  check(!reports.empty() && reports.back().bytesHashed == total &&
+            reports.back().totalBytes == total,
+        "progress");
+
+  // Without the v1 part the same files give the same v2 hashes
+  creator.setHybrid(false);
+  TorrentMetainfo v2 =
+      TorrentMetainfo::parse(creator.create((dir / "album").string()));
+  check(v2.hasV2() && !v2.hasV1() &&
+            v2.getPieceCount() == meta.getPieceCount() &&
+            v2.getMerklePiece(5)->root == meta.getMerklePiece(5)->root &&
+            verifies(v2, data),
+        "v2 only");
+  creator.setHybrid(true);
+
+  // The client name is settable
+  check(creator.create((dir / "album").string()).find(
+            "10:created by11:SmolTorrent") != std::string::npos,
+        "created by");
+  creator.setCreatedBy("");
+  check(creator.create((dir / "album").string()).find("created by") ==
+            std::string::npos,
+        "no created by");
+
+  // A single file, with the piece length picked automatically
+  creator.setPieceLength(0);
+  TorrentMetainfo single = TorrentMetainfo::parse(
+      creator.create((dir / "album" / "disc1" / "01.flac").string()));
+  check(!single.isMultiFile() && single.getName() == "01.flac" &&
+            single.hasV1() && single.getTotalLength() == 300000 &&
+            verifies(single, entries[2].data),
+        "single file");
+
+  // A directory holding one file stays a directory: its v2 file tree
+  // looks like a single file, and the v1 file list decides
+  TorrentMetainfo lone = TorrentMetainfo::parse(
+      creator.create((dir / "album" / "disc1").string()));
+  check(lone.isMultiFile() && lone.getFiles().size() == 1 &&
+            lone.getFiles()[0].path == "disc1/01.flac",
+        "directory with one file");
+
+  bool threw = false;
+  try {
+    creator.create((dir / "missing").string());
+  } catch (const std::exception&) {
+    threw = true;
+  }
+  check(threw, "missing input");
+  threw = false;
+  creator.setPieceLength(1000);
+  try {
+    creator.create((dir / "album").string());
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  check(threw, "bad piece length");
+  fs::remove_all(dir);
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/TorrentLoader.hpp"
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string path = argc > 1
+                         ? argv[1]
+                         : "torrents/ubuntu-20.04.6-desktop-amd64.iso.torrent";
+  fs::path dir = fs::temp_directory_path() / "test_TorrentLoader";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  for (int i = 0; i < 9; i++) {
+    fs::copy_file(path, dir / ("copy" + std::to_string(i) + ".torrent"));
+  }
+  std::ofstream(dir / "broken.torrent") << "d4:infod4:name1:xee";
+  std::ofstream(dir / "notes.txt") << "not a torrent";
+
+  ThreadPool pool(3);
+  TorrentLoader loader(pool, 2);
+  std::vector<LoadedTorrent> torrents;
+  std::vector<LoadError> errors;
+  size_t batches = 0, reports = 0;
+  loader.onBatch([&](std::vector<LoadedTorrent>&& batch) {
+    batches++;
+    for (auto& torrent : batch) torrents.push_back(std::move(torrent));
+  });
+  loader.onError([&](const LoadError& error) { errors.push_back(error); });
+  loader.onProgress([&](const TorrentLoader::Progress&) { reports++; });
+  TorrentLoader::Progress progress = loader.load(dir.string());
+
+  check(progress.total == 10 && progress.loaded == 9 && progress.failed == 1,
+        "counts");
+  check(torrents.size() == 9 && batches == 5 && reports == 5,
+        "batches and progress");
+  check(errors.size() == 1 &&
+            fs::path(errors[0].path).filename() == "broken.torrent" &&
+            !errors[0].message.empty(),
+        "per-file error");
+  bool ordered = true;
+  for (size_t i = 0; i < torrents.size(); i++) {
+    ordered = ordered &&
+              fs::path(torrents[i].path).filename() ==
+                  "copy" + std::to_string(i) + ".torrent" &&
+              torrents[i].metainfo.getName() ==
+                  "ubuntu-20.04.6-desktop-amd64.iso";
+  }
+  check(ordered, "directory order");
+
+  // A second run restores unchanged files from the metainfo cache
+  std::string cachePath = (dir / "metainfo.cache").string();
+  TorrentLoader cached(pool, 4);
+  cached.useCache(cachePath);
+  std::vector<LoadedTorrent> restored;
+  cached.onBatch([&](std::vector<LoadedTorrent>&& batch) {
+    for (auto& torrent : batch) restored.push_back(std::move(torrent));
+  });
+  check(cached.load(dir.string()).cached == 0 && fs::exists(cachePath),
+        "cache written");
+  auto written = fs::last_write_time(cachePath);
+  restored.clear();
+  progress = cached.load(dir.string());
+  check(progress.loaded == 9 && progress.cached == 9 &&
+            fs::last_write_time(cachePath) == written &&
+            std::ranges::equal(restored[4].metainfo.getPieceHashes(),
+                               torrents[4].metainfo.getPieceHashes()),
+        "restored from cache");
+  fs::last_write_time(dir / "copy3.torrent",
+                      fs::last_write_time(dir / "copy3.torrent") +
+                          std::chrono::seconds(1));
+  fs::remove(dir / "copy8.torrent");
+  progress = cached.load(dir.string());
+  check(progress.loaded == 8 && progress.cached == 7 &&
+            MetainfoCache(cachePath).size() == 8,
+        "stale entries refreshed");
+
+  // A handler that throws stops the load only once queued batches are done.
+  // The first batch is small and the rest large, so they are still busy
+  // while the exception unwinds; run under AddressSanitizer with
+  // detect_stack_use_after_return=1 to catch a batch outliving load().
+  fs::path slow = dir / "slow";
+  fs::create_directories(slow);
+  size_t pieces = 1 << 19;
+  std::string large = "d4:infod6:lengthi" + std::to_string(pieces * 4) +
+                      "e4:name1:x12:piece lengthi4e6:pieces" +
+                      std::to_string(pieces * 20) + ":" +
+                      std::string(pieces * 20, 'h') + "ee";
+  for (int i = 0; i < 8; i++) {
+    std::ofstream(slow / ("large" + std::to_string(i) + ".torrent")) << large;
+  }
+  fs::copy_file(path, slow / "a.torrent");
+  fs::copy_file(path, slow / "b.torrent");
+  TorrentLoader failing(pool, 2);
+  failing.useCache((slow / "metainfo.cache").string());
+  failing.onBatch([](std::vector<LoadedTorrent>&&) {
+    throw std::runtime_error("handler failed");
+  });
+  bool threw = false;
+  try {
+    failing.load(slow.string());
+  } catch (const std::runtime_error& e) {
+    threw = std::string(e.what()) == "handler failed";
+  }
+  check(threw, "handler exception");
+  failing.onBatch([](std::vector<LoadedTorrent>&&) {});
+  check(failing.load(slow.string()).loaded == 10,
+        "loader usable after a handler throws");
+
+  threw = false;
+  try {
+    loader.load((dir / "missing").string());
+  } catch (const fs::filesystem_error&) {
+    threw = true;
+  }
+  check(threw, "missing directory");
+  fs::remove_all(dir);
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../include/MappedFile.hpp"
+#include "../include/TorrentMetainfo.hpp"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+static std::string bstr(const std::string& s) {
+  return std::to_string(s.size()) + ":" + s;
+}
+
+static std::string bytes(const MerkleTree::Hash& hash) {
+  return std::string(hash.begin(), hash.end());
+}
+
+using Dict = std::map<BencodeValue::KeyType, BencodeValue>;
+
+int main(int argc, char** argv) {
+  // Single-file torrent
+  std::string path = argc > 1
+                         ? argv[1]
+                         : "torrents/ubuntu-20.04.6-desktop-amd64.iso.torrent";
+  MappedFile file(path);
+  TorrentMetainfo ubuntu = TorrentMetainfo::parse(file.view());
+  check(ubuntu.getName() == "ubuntu-20.04.6-desktop-amd64.iso" &&
+            !ubuntu.isMultiFile() && ubuntu.getFiles().size() == 1,
+        "single-file name");
+  check(ubuntu.getAnnounce() == "https://torrent.ubuntu.com/announce" &&
+            ubuntu.getAnnounceList().size() == 2,
+        "announce");
+  size_t last = ubuntu.getPieceCount() - 1;
+  check(uint64_t{ubuntu.getPieceLength()} * last + ubuntu.getPieceSize(last) ==
+            ubuntu.getTotalLength(),
+        "piece sizes add up");
+  check(SHA1::toString(ubuntu.getInfoHash()) ==
+            "5f5e8848426129ab63cb4db717bb54193c1c1ad7",
+        "v1 info hash");
+
+  // Three files of 5, 0 and 7 bytes in 4-byte pieces:
+  //   piece 0: a[0,4)  piece 1: a[4,5) c[0,3)  piece 2: c[3,7)
+  std::string hashes(3 * 20, 'h');
+  hashes[20] = '1';
+  std::string multi =
+      "d4:infod5:filesl"
+      "d6:lengthi5e4:pathl" + bstr("a") + "ee"
+      "d6:lengthi0e4:pathl" + bstr("dir") + bstr("b") + "ee"
+      "d6:lengthi7e4:pathl" + bstr("c") + "ee"
+      "e4:name4:root12:piece lengthi4e6:pieces60:" + hashes + "ee";
+  TorrentMetainfo meta = TorrentMetainfo::parse(multi);
+  check(meta.isMultiFile() && meta.getFiles().size() == 3 &&
+            meta.getFiles()[1].path == "root/dir/b" &&
+            meta.getFiles()[2].offset == 5 && meta.getTotalLength() == 12,
+        "file table");
+  check(meta.getPieceCount() == 3 && meta.getPieceHash(1)[0] == '1' &&
+            meta.getPieceHashes().data()->data() + 20 ==
+                meta.getPieceHash(1).data(),
+        "contiguous piece hashes");
+  check(meta.fileAt(4) == 0 && meta.fileAt(5) == 2 && meta.fileAt(11) == 2,
+        "file at offset");
+
+  std::vector<TorrentMetainfo::FileSlice> slices;
+  meta.forEachSlice(1, [&](TorrentMetainfo::FileSlice s) {
+    slices.push_back(s);
+  });
+  check(slices.size() == 2 && slices[0].file == 0 && slices[0].offset == 4 &&
+            slices[0].length == 1 && slices[1].file == 2 &&
+            slices[1].offset == 0 && slices[1].length == 3,
+        "piece spanning files skips empty ones");
+  slices.clear();
+  meta.forEachSlice(2, 1, 2, [&](TorrentMetainfo::FileSlice s) {
+    slices.push_back(s);
+  });
+  check(slices.size() == 1 && slices[0].file == 2 && slices[0].offset == 4 &&
+            slices[0].length == 2,
+        "block within a file");
+  check(meta.fileRange(1) == std::make_pair(size_t{0}, size_t{3}) &&
+            meta.fileRange(2) == std::make_pair(size_t{2}, size_t{3}),
+        "file range");
+
+  bool threw = false;
+  try {
+    meta.forEachSlice(0, 2, 3, [](TorrentMetainfo::FileSlice) {});
+  } catch (const std::out_of_range&) {
+    threw = true;
+  }
+  check(threw, "block past the end of a piece");
+
+  // Inconsistent metainfo is rejected
+  std::vector<std::string> bad = {
+      "d4:infod6:lengthi5e4:name1:x12:piece lengthi4e6:pieces20:" +
+          hashes.substr(0, 20) + "ee",
+      "d4:infod6:lengthi5e4:name1:x12:piece lengthi0e6:pieces0:ee",
+      "d4:infod5:filesld6:lengthi1e4:pathl2:..eee4:name1:x"
+      "12:piece lengthi4e6:pieces20:" + hashes.substr(0, 20) + "ee",
+      "d4:infod4:name1:x12:piece lengthi4e6:pieces19:" +
+          hashes.substr(0, 19) + "ee",
+      "d8:announcei1ee",
+      // Names and paths that would leave the download directory
+      "d4:infod6:lengthi4e4:name2:..12:piece lengthi4e6:pieces20:" +
+          hashes.substr(0, 20) + "ee",
+      "d4:infod6:lengthi4e4:name11:/etc/passwd12:piece lengthi4e"
+      "6:pieces20:" + hashes.substr(0, 20) + "ee",
+      "d4:infod5:filesld6:lengthi1e4:pathl1:feee4:name9:a/../../x"
+      "12:piece lengthi4e6:pieces20:" + hashes.substr(0, 20) + "ee",
+      "d4:infod5:filesld6:lengthi1e4:pathleee4:name1:x"
+      "12:piece lengthi4e6:pieces20:" + hashes.substr(0, 20) + "ee",
+      // Keys out of order, or an info dictionary given twice
+      "d4:infod4:name1:x6:lengthi4e12:piece lengthi4e6:pieces20:" +
+          hashes.substr(0, 20) + "ee",
+      "d4:infod6:lengthi4e4:name1:x12:piece lengthi4e6:pieces20:" +
+          hashes.substr(0, 20) + "e4:infod6:lengthi4e4:name1:y"
+          "12:piece lengthi4e6:pieces20:" + hashes.substr(0, 20) + "ee"};
+  for (const std::string& torrent : bad) {
+    threw = false;
+    try {
+      TorrentMetainfo::parse(torrent);
+    } catch (const std::invalid_argument&) {
+      threw = true;
+    }
+    check(threw, "reject " + torrent.substr(0, 40));
+  }
+
+  // v2: a 40000-byte file over two 32 KiB pieces and a 100-byte file. The
+  // second file starts at the next piece boundary.
+  std::string a(40000, 'a'), b(100, 'b');
+  MerkleTree treeA = MerkleTree::fromData(a), treeB = MerkleTree::fromData(b);
+  std::string layerA;
+  for (const auto& hash : treeA.pieceLayer(2)) layerA += bytes(hash);
+  Dict fileTree = {
+      {"a", Dict{{"", Dict{{"length", int64_t(a.size())},
+                           {"pieces root", bytes(treeA.root())}}}}},
+      {"sub", Dict{{"b", Dict{{"", Dict{{"length", int64_t(b.size())},
+                                        {"pieces root",
+                                         bytes(treeB.root())}}}}}}},
+      {"empty", Dict{{"", Dict{{"length", int64_t(0)}}}}}};
+  Dict v2Info = {{"file tree", fileTree},
+                 {"meta version", int64_t(2)},
+                 {"name", std::string("v2")},
+                 {"piece length", int64_t(32768)}};
+  Dict v2Root = {{"info", v2Info},
+                 {"piece layers", Dict{{bytes(treeA.root()), layerA}}}};
+  std::string v2Data = BencodeValue(v2Root).toString();
+  TorrentMetainfo v2 = TorrentMetainfo::parse(v2Data);
+  const auto& v2Files = v2.getFiles();
+  check(v2.hasV2() && !v2.hasV1() && v2.isMultiFile() &&
+            v2Files.size() == 4 && v2Files[0].path == "v2/a" &&
+            v2Files[1].path == "v2/empty" && v2Files[2].pad &&
+            v2Files[3].path == "v2/sub/b" && v2Files[3].offset == 65536 &&
+            v2.getPieceCount() == 3,
+        "v2 file tree layout");
+  check(v2.getInfoHashV2() == MerkleTree::hashBlock(
+                                  BencodeValue(v2Info).toString()),
+        "v2 info hash");
+
+  // Each piece verifies from its block hashes
+  std::string padded = a + std::string(65536 - a.size(), '\0') + b;
+  bool verified = true;
+  for (size_t piece = 0; piece < v2.getPieceCount(); piece++) {
+    auto expected = v2.getMerklePiece(piece);
+    std::vector<MerkleTree::Hash> leaves;
+    v2.forEachSlice(piece, [&](TorrentMetainfo::FileSlice slice) {
+      if (v2Files[slice.file].pad) return;
+      std::string_view data = std::string_view(padded).substr(
+          v2Files[slice.file].offset + slice.offset, slice.length);
+      for (size_t i = 0; i < data.size(); i += MerkleTree::blockSize) {
+        leaves.push_back(
+            MerkleTree::hashBlock(data.substr(i, MerkleTree::blockSize)));
+      }
+    });
+    verified = verified && expected && expected->blocks == leaves.size() &&
+               MerkleTree::subtreeRoot(leaves.data(), leaves.size(),
+                                       expected->width) == expected->root;
+  }
+  check(verified, "v2 pieces verify");
+  std::string damaged = padded;
+  damaged[65600] ^= 1;
+  check(v2.verifyPiece(0, padded.substr(0, 32768)) &&
+            v2.verifyPiece(1, padded.substr(32768, 32768)) &&
+            v2.verifyPiece(2, padded.substr(65536)) &&
+            !v2.verifyPiece(2, damaged.substr(65536)) &&
+            !v2.verifyPiece(0, padded.substr(0, 1000)),
+        "v2 verify piece");
+
+  // Hybrid: the same files in a v1 list with a BEP 47 pad file
+  Dict hybridInfo = v2Info;
+  std::vector<BencodeValue> v1Files = {
+      Dict{{"length", int64_t(a.size())},
+           {"path", std::vector<BencodeValue>{std::string("a")}}},
+      Dict{{"length", int64_t(0)},
+           {"path", std::vector<BencodeValue>{std::string("empty")}}},
+      Dict{{"attr", std::string("p")},
+           {"length", int64_t(65536 - a.size())},
+           {"path", std::vector<BencodeValue>{std::string(".pad"),
+                                              std::string("0")}}},
+      Dict{{"length", int64_t(b.size())},
+           {"path", std::vector<BencodeValue>{std::string("sub"),
+                                              std::string("b")}}}};
+  hybridInfo["files"] = v1Files;
+  std::string pieces;
+  for (size_t at = 0; at < padded.size(); at += 32768) {
+    auto hash = SHA1::hash(std::string_view(padded).substr(at, 32768));
+    pieces.append(hash.begin(), hash.end());
+  }
+  hybridInfo["pieces"] = pieces;
+  Dict hybridRoot = v2Root;
+  hybridRoot["info"] = hybridInfo;
+  TorrentMetainfo hybrid =
+      TorrentMetainfo::parse(BencodeValue(hybridRoot).toString());
+  check(hybrid.hasV1() && hybrid.hasV2() &&
+            hybrid.getFiles()[3].piecesRoot == treeB.root() &&
+            hybrid.getMerklePiece(1)->root == v2.getMerklePiece(1)->root,
+        "hybrid torrent");
+  check(hybrid.verifyPiece(1, padded.substr(32768, 32768)) &&
+            !hybrid.verifyPiece(2, damaged.substr(65536)),
+        "hybrid verify piece");
+
+  // A piece layer that does not hash to its root is rejected
+  std::string corrupt = layerA;
+  corrupt[0] ^= 1;
+  v2Root["piece layers"] = Dict{{bytes(treeA.root()), corrupt}};
+  threw = false;
+  try {
+    TorrentMetainfo::parse(BencodeValue(v2Root).toString());
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  check(threw, "reject corrupt piece layer");
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -1,141 +1,276 @@
-
+#include <cstdint>
 #include <iostream>
-#include <map>
-#include <sstream>
-#include <stdexcept>
+#include <iterator>
 #include <string>
-#include <variant>
-#include <vector>
-
-class BencodeValue {
- public:
-  // Define the variant type that can hold int64_t, string, vector (for lists),
-  // or map (for dicts)
-  using ValueType =
-      std::variant<int64_t, std::string, std::vector<BencodeValue>,
-                   std::map<std::string, BencodeValue>>;
-
-  // Constructors for different types
-  BencodeValue() {};
-  BencodeValue(int64_t val) : value(val) {}
-  BencodeValue(const std::string& str) : value(str) {}
-  BencodeValue(const std::vector<BencodeValue>& list) : value(list) {}
-  BencodeValue(const std::map<std::string, BencodeValue>& dict) : value(dict) {}
-
-  // Encoding function
-  std::string encode() const { return encodeHelper(value); }
-
-  // Decoding function (this example is a simplified version, assumes valid
-  // input)
-  static BencodeValue decode(const std::string& str) {
-    return decodeHelper(str, 0).first;
+
+#include "../include/BencodeBinding.hpp"
+#include "../include/BencodeParallel.hpp"
+#include "../include/BencodeQuery.hpp"
+#include "../include/BencodeStream.hpp"
+#include "../include/BencodeTape.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/TorrentParser.hpp"
+#include "../include/utils.hpp"
+
+struct Peer {
+  std::array<uint8_t, 4> ip;
+  uint16_t port;
+  std::optional<std::string> client;
+};
+
+template <>
+struct BencodeFields<Peer> {
+  static constexpr auto fields =
+      std::make_tuple(bencodeField("client", &Peer::client),
+                      bencodeField("ip", &Peer::ip),
+                      bencodeField("port", &Peer::port));
+};
+
+struct Announce {
+  int64_t interval;
+  std::vector<Peer> peers;
+};
+
+template <>
+struct BencodeFields<Announce> {
+  static constexpr auto fields =
+      std::make_tuple(bencodeField("interval", &Announce::interval),
+                      bencodeField("peers", &Announce::peers));
+};
+
+struct Totals {
+  uint64_t uploaded;
+};
+
+template <>
+struct BencodeFields<Totals> {
+  static constexpr auto fields =
+      std::make_tuple(bencodeField("uploaded", &Totals::uploaded));
+};
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
   }
+}
 
- private:
-  // The variant value
-  ValueType value;
+int main(int argc, char** argv) {
+  using namespace std::string_literals;
+  Bencoder bencoder;
 
-  // Helper function for encoding
-  std::string encodeHelper(const ValueType& val) const {
-    if (std::holds_alternative<int64_t>(val)) {
-      return std::to_string(std::get<int64_t>(val));
-    }
-    if (std::holds_alternative<std::string>(val)) {
-      const auto& str = std::get<std::string>(val);
-      return std::to_string(str.size()) + ":" + str;
-    }
-    if (std::holds_alternative<std::vector<BencodeValue>>(val)) {
-      const auto& list = std::get<std::vector<BencodeValue>>(val);
-      std::string result = "l";
-      for (const auto& item : list) {
-        result += item.encode();
-      }
-      return result + "e";
-    }
-    if (std::holds_alternative<std::map<std::string, BencodeValue>>(val)) {
-      const auto& dict = std::get<std::map<std::string, BencodeValue>>(val);
-      std::string result = "d";
-      for (const auto& pair : dict) {
-        result += std::to_string(pair.first.size()) + ":" + pair.first +
-                  pair.second.encode();
-      }
-      return result + "e";
+  // Round trip through the owning decoder
+  std::string sample = "d3:bar4:spam3:fooi42e4:listli-7e3:abcee";
+  BencodeValue value = bencoder.decode(sample);
+  check(bencoder.encode(value) == sample, "decode/encode round trip");
+
+  // Encoder sizes and writes exactly, through any sink
+  BencodeValue numbers(std::vector<BencodeValue>{
+      BencodeValue(int64_t{0}), BencodeValue(INT64_MIN),
+      BencodeValue(INT64_MAX), BencodeValue(std::string(12, 'x'))});
+  std::string expected = "li0ei-9223372036854775808ei9223372036854775807e"
+                         "12:xxxxxxxxxxxxe";
+  check(numbers.encodedSize() == expected.size() &&
+            numbers.toString() == expected,
+        "encode integer limits");
+  std::string appended = "prefix";
+  numbers.appendTo(appended);
+  check(appended == "prefix" + expected, "encode append");
+  std::vector<char> sink;
+  numbers.encodeTo(std::back_inserter(sink));
+  check(std::string(sink.begin(), sink.end()) == expected, "encode iterator");
+
+  // Struct binding decodes and encodes without a BencodeValue tree
+  std::string announce =
+      "d8:completei5e8:intervali1800e5:peersld6:client2:qB2:ip4:\x7f\0\0\x01"
+      "4:porti6881eed2:ip4:\x0a\0\0\x02\x34:porti51413eeee"s;
+  Announce decoded = BencodeBinding::decode<Announce>(announce);
+  check(decoded.interval == 1800 && decoded.peers.size() == 2 &&
+            decoded.peers[0].client == "qB" && decoded.peers[0].ip[0] == 127 &&
+            !decoded.peers[1].client && decoded.peers[1].port == 51413,
+        "binding decode");
+  check(BencodeBinding::encode(decoded) == "d" + announce.substr(14),
+        "binding encode");
+  for (std::string bad : {"d5:peerslee", "d8:intervali1e5:peersld2:ip3:abc"
+                                         "4:porti1eeee",
+                          "d8:intervali1e5:peersld2:ip4:abcd4:porti70000eeee"}) {
+    bool threw = false;
+    try {
+      BencodeBinding::decode<Announce>(bad);
+    } catch (const std::invalid_argument&) {
+      threw = true;
     }
-    throw std::runtime_error("Unsupported type in bencode encoding");
+    check(threw, "binding rejects " + bad);
+  }
+  check(BencodeBinding::decode<Totals>(BencodeBinding::encode(Totals{
+                INT64_MAX})).uploaded == INT64_MAX,
+        "binding encodes unsigned");
+  bool threw = false;
+  try {
+    BencodeBinding::encode(Totals{uint64_t{INT64_MAX} + 1});
+  } catch (const std::invalid_argument&) {
+    threw = true;
   }
+  check(threw, "binding rejects an unsigned value past int64");
 
-  // Helper function for decoding
-  static std::pair<BencodeValue, size_t> decodeHelper(const std::string& str,
-                                                      size_t pos) {
-    if (str[pos] == 'd') {
-      std::map<std::string, BencodeValue> dict;
-      pos++;
-      while (str[pos] != 'e') {
-        // Read key
-        size_t key_len = std::stoi(str.substr(pos, str.find(':', pos) - pos));
-        pos = str.find(':', pos) + 1;
-        std::string key = str.substr(pos, key_len);
-        pos += key_len;
-
-        // Read value
-        auto [value, new_pos] = decodeHelper(str, pos);
-        dict[key] = value;
-        pos = new_pos;
-      }
-      return {BencodeValue(dict), pos + 1};  // Skip 'e'
-    }
-    if (str[pos] == 'l') {
-      std::vector<BencodeValue> list;
-      pos++;
-      while (str[pos] != 'e') {
-        auto [value, new_pos] = decodeHelper(str, pos);
-        list.push_back(value);
-        pos = new_pos;
-      }
-      return {BencodeValue(list), pos + 1};  // Skip 'e'
-    }
-    if (std::isdigit(str[pos])) {
-      size_t len = std::stoi(str.substr(pos, str.find(':', pos) - pos));
-      pos = str.find(':', pos) + 1;
-      std::string value = str.substr(pos, len);
-      return {BencodeValue(value), pos + len};
-    }
-    if (str[pos] == '-') {
-      size_t end_pos = str.find(':', pos);
-      int64_t value = std::stoll(str.substr(pos, end_pos - pos));
-      pos = end_pos + 1;
-      return {BencodeValue(value), pos};
+  // Zero-copy decoding points into the source buffer
+  BencodeView view = bencoder.decodeView(sample);
+  const BencodeView* bar = view.find("bar");
+  check(bar && std::get<std::string_view>(bar->value) == "spam", "view string");
+  check(std::get<std::string_view>(bar->value).data() == sample.data() + 8,
+        "view string is not a copy");
+  const BencodeView* foo = view.find("foo");
+  check(foo && std::get<int64_t>(foo->value) == 42, "view integer");
+  check(view.find("missing") == nullptr, "missing key");
+  check(view.toValue().toString() == sample, "view to owning value");
+
+  // Both decoders keep the first value of a repeated key
+  std::string repeated = "d1:ai1e1:ai2ee";
+  check(bencoder.decode(repeated).toString() == "d1:ai1ee" &&
+            std::get<int64_t>(bencoder.decodeView(repeated).find("a")->value) ==
+                1,
+        "repeated key keeps the first value");
+
+  // Malformed input is rejected
+  for (std::string bad : {"i12", "i1x2e", "ie", "5:abc", "l", "d3:fooe", "x"}) {
+    bool threw = false;
+    try {
+      bencoder.decodeView(bad);
+    } catch (const std::invalid_argument&) {
+      threw = true;
     }
-    throw std::runtime_error("Invalid bencode string format");
+    check(threw, "reject " + bad);
   }
-};
 
-class Bencoder {
- public:
-  BencodeValue decode(const std::string str){
-    if(str[0]=='i'){
-      if(str.size()<2 || str.back()!='e') throw std::invalid_argument("Invalid Bencode string format");
-      return BencodeValue(std::stoll(str.substr(1,str.size()-2)));
-    }
-    if(str[0]=='d'){
-      if(str.size()<2 || str.back()!='e') throw std::invalid_argument("Invalid Bencode string format");
-      return decodeDict(str.substr(1,str.size()-2));
-    }
-    if(str[0]=='l'){
-      if(str.size()<2 || str.back()!='e') throw std::invalid_argument("Invalid Bencode string format");
-      return decodeList(str.substr(1,str.size()-2));
-    }
-    if(std::isdigit(str[0])){
-      size_t colon_pos = str.find(':');
-      if(colon_pos==std::string::npos) throw std::invalid_argument("Invalid Bencode string format");
-      int64_t length = std::stoll(str.substr(0,colon_pos));
-      if(colon_pos+1+length>str.size()) throw std::invalid_argument("String length exceeds available data");
-      return BencodeValue(str.substr(colon_pos+1,length));
+  // Memory-mapped .torrent file
+  std::string path = argc > 1
+                         ? argv[1]
+                         : "torrents/ubuntu-20.04.6-desktop-amd64.iso.torrent";
+  MappedFile file(path);
+  BencodeView torrent = bencoder.decodeView(file.view());
+  const BencodeView* info = torrent.find("info");
+  check(info && info->find("pieces") &&
+            std::get<std::string_view>(info->find("pieces")->value).size() %
+                    20 == 0,
+        "torrent pieces");
+  check(bencoder.encode(torrent.toValue()) == file.view(),
+        "torrent round trip");
+
+  // Lazy path queries agree with the decoded document
+  BencodeCursor cursor(file.view());
+  check(cursor.path("info.name")->asString() ==
+            std::get<std::string_view>(info->find("name")->value),
+        "query name");
+  check(cursor.path("info.piece length")->asInteger() ==
+            std::get<int64_t>(info->find("piece length")->value),
+        "query piece length");
+  check(cursor.path("announce-list[1][0]")->asString() ==
+            "https://ipv6.torrent.ubuntu.com/announce",
+        "query list index");
+  check(!cursor.path("announce-list[9]") && !cursor.path("info.files[0]"),
+        "query missing path");
+  check(cursor.path("info")->raw().size() ==
+                info->toValue().encodedSize() &&
+            cursor.size() == std::get<BencodeView::Dict>(torrent.value).size(),
+        "query raw and size");
+
+  // Parallel decoding of a large list matches the serial result
+  std::string files = "d4:infod5:filesl";
+  for (int i = 0; i < 5000; i++) {
+    files += "d6:lengthi" + std::to_string(i) + "e4:pathl1:a" +
+             std::to_string(i % 10) + ":" + std::string(i % 10, 'x') + "ee";
+  }
+  files += "e4:name3:abcee";
+  ThreadPool pool(4);
+  ParallelDecoder parallel(pool, 256);
+  check(parallel.decode(files).toValue().toString() == files &&
+            parallel.decode(file.view()).toValue().toString() == file.view(),
+        "parallel decode");
+
+  // Info dictionary bytes captured during decode hash like a re-encoding
+  Bencoder capturing;
+  capturing.captureKey("info");
+  capturing.decodeView(file.view());
+  auto rawInfo = capturing.captured("info");
+  check(rawInfo && capturing.isCanonical() &&
+            getSha256(*rawInfo) == getSha256(info->toValue().toString()),
+        "captured info span");
+  capturing.decode("d4:infod1:bi1e1:ai2eee");
+  check(!capturing.isCanonical() &&
+            capturing.captured("info") == std::string_view("d1:bi1e1:ai2ee"),
+        "non-canonical keys detected");
+  capturing.decode("d1:xd4:infoi1eee");
+  check(!capturing.captured("info"), "only top-level keys are captured");
+  threw = false;
+  try {
+    capturing.decodeView("d4:infoi1e4:infoi2ee");
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  check(threw, "repeated captured key");
+
+  // Tape document over the same buffer
+  Arena arena;
+  TapeDecoder tapeDecoder(arena);
+  BencodeTape tape = tapeDecoder.decode(file.view());
+  auto tapeInfo = tape.root().find("info");
+  check(tapeInfo && tapeInfo->find("pieces")->asString() ==
+                        std::get<std::string_view>(info->find("pieces")->value),
+        "tape pieces");
+  check(tape.consumed() == file.size(), "tape consumed");
+  check(bencoder.encode(tape.root().toValue()) == file.view(),
+        "tape round trip");
+  BencodeTape unsorted = tapeDecoder.decode("d1:bi2e1:ai1ee");
+  check(unsorted.root().find("a")->asInteger() == 1 &&
+            unsorted.root().find("b")->asInteger() == 2,
+        "tape unsorted keys");
+
+  // Every scanner kernel finds the same terminators as a byte search
+  for (auto kernel : {StructuralIndex::Kernel::Scalar,
+                      StructuralIndex::Kernel::SSE2,
+                      StructuralIndex::Kernel::Auto}) {
+    StructuralIndex index;
+    index.reset(file.view(), kernel);
+    bool same = true;
+    for (size_t pos = 0; pos < file.size(); pos += 997) {
+      same = same && index.nextColon(pos) == file.view().find(':', pos) &&
+             index.nextEnd(pos) == file.view().find('e', pos);
     }
-    throw std::invalid_argument("Invalid Bencode string format");
+    check(same, "structural index");
   }
-  BencodeValue decodeDict(const std::string & val);
-};
 
-// Example Usage
-int main() { return 0; };
+  // Streaming decode from uneven chunks, stopping at the end of the document
+  std::string stream = std::string(file.view()) + "trailing";
+  BencodeValueBuilder builder;
+  BencodeStreamDecoder streamDecoder(builder);
+  size_t offset = 0, used = 0;
+  for (size_t chunk = 1; offset < stream.size(); chunk = chunk * 3 % 4093 + 1) {
+    std::string_view piece = std::string_view(stream).substr(offset, chunk);
+    used += streamDecoder.feed(piece);
+    offset += piece.size();
+  }
+  check(streamDecoder.done() && used == file.size(), "stream consumed");
+  check(builder.result() &&
+            bencoder.encode(*builder.result()) == file.view(),
+        "stream round trip");
+  BencodeValueBuilder partial;
+  BencodeStreamDecoder partialDecoder(partial);
+  check(partialDecoder.feed("d3:fooi4") == 8 && !partialDecoder.done() &&
+            partialDecoder.feed("2ee") == 3 && partialDecoder.done(),
+        "stream resumes inside an integer");
+
+  // Hostile nesting is rejected without recursion
+  std::string deep(100000, 'l');
+  threw = false;
+  try {
+    tapeDecoder.decode(deep);
+  } catch (const std::invalid_argument&) {
+    threw = true;
+  }
+  check(threw, "tape depth limit");
+
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+
+#include "../include/sha1.h"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+  if (!condition) {
+    std::cout << "Failed: " << name << std::endl;
+    failures++;
+  }
+}
+
+int main() {
+  // FIPS 180 test vectors
+  struct Vector {
+    std::string input;
+    std::string expected;
+  };
+  Vector vectors[] = {
+      {"", "da39a3ee5e6b4b0d3255bfef95601890afd80709"},
+      {"abc", "a9993e364706816aba3e25717850c26c9cd0d89d"},
+      {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+       "84983e441c3bd26ebaae4aa1f95129e5e54670f1"},
+      {std::string(1000000, 'a'), "34aa973cd4c4daa4f61eeb2bdbad27316534016f"},
+  };
+  for (bool hardware : {false, true}) {
+    for (const Vector& v : vectors) {
+      SHA1 sha(hardware);
+      sha.update(v.input);
+      check(SHA1::toString(sha.digest()) == v.expected,
+            "vector of " + std::to_string(v.input.size()) + " bytes" +
+                (hardware ? " (dispatched)" : " (scalar)"));
+    }
+  }
+
+  // Every length around the block and padding boundaries, fed in uneven
+  // pieces, agrees between the two implementations and the one-shot hash
+  std::string data(1000, '\0');
+  for (size_t i = 0; i < data.size(); i++) data[i] = char(i * 131 + 7);
+  bool same = true;
+  for (size_t length = 0; length < 300; length++) {
+    std::string_view input = std::string_view(data).substr(0, length);
+    SHA1 scalar(false), dispatched;
+    scalar.update(input);
+    for (size_t at = 0; at < length; at += 37) {
+      dispatched.update(input.substr(at, 37));
+    }
+    SHA1::Digest expected = scalar.digest();
+    same = same && dispatched.digest() == expected &&
+           SHA1::hash(input) == expected;
+  }
+  check(same, "incremental updates");
+
+  std::cout << "SHA-NI: " << (SHA1::hardwareAccelerated() ? "yes" : "no")
+            << std::endl;
+  std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -2,6 +2,15 @@
 #include <string>
 #include "../include/sha256.h"
 
+static int failures = 0;
+
+static void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "Failed: " << name << std::endl;
+        failures++;
+    }
+}
+
 int main() {
     // Example test vector
     std::string input = "abc";
@@ -22,5 +31,46 @@ int main() {
     std::cout << result.size()<< std::endl;
     std::cout << "Hash: " << result << std::endl;
 
-    return 0;
+    // FIPS 180 test vectors, on the portable and the dispatched path
+    struct Vector {
+        std::string input;
+        std::string expected;
+    };
+    Vector vectors[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {std::string(1000000, 'a'),
+         "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+    for (bool hardware : {false, true}) {
+        for (const Vector& v : vectors) {
+            SHA256 s(hardware);
+            s.update(v.input);
+            check(SHA256::toHex(s.digest()).data() == v.expected,
+                  "vector of " + std::to_string(v.input.size()) + " bytes" +
+                      (hardware ? " (dispatched)" : " (scalar)"));
+        }
+    }
+
+    // Uneven updates across block boundaries agree between the two paths
+    std::string data(1000, '\0');
+    for (size_t i = 0; i < data.size(); i++) data[i] = char(i * 131 + 7);
+    bool same = true;
+    for (size_t length = 0; length < 300; length++) {
+        std::string_view part = std::string_view(data).substr(0, length);
+        SHA256 scalar(false), dispatched;
+        scalar.update(part);
+        for (size_t at = 0; at < length; at += 37) {
+            dispatched.update(part.substr(at, 37));
+        }
+        same = same && scalar.digest() == dispatched.digest();
+    }
+    check(same, "incremental updates");
+
+    std::cout << "SHA-NI: " << (SHA256::hardwareAccelerated() ? "yes" : "no")
+              << std::endl;
+    std::cout << (failures == 0 ? "Success" : "Failed") << std::endl;
+    return failures == 0 ? 0 : 1;
 }